@@ -1,8 +1,20 @@
 #if !defined(FMX_NET_HPP)
 #define FMX_NET_HPP
 
+#include "socket.hpp"
 #include "tcp.hpp"
 #include "http.hpp"
 #include "udp.hpp"
+#include "framing.hpp"
+#include "pool.hpp"
+#include "dualstack.hpp"
+#include "sockopt.hpp"
+#include "rudp.hpp"
+#include "unix.hpp"
+#include "shm.hpp"
+#include "hpack.hpp"
+#include "http2.hpp"
+#include "trace.hpp"
+#include "replay.hpp"
 
 #endif // FMX_NET_HPP
\ No newline at end of file
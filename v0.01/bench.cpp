@@ -0,0 +1,439 @@
+// Loopback benchmarks for the transports and codecs.
+//
+//   g++ -std=c++17 -O2 -pthread bench.cpp -o bench -lrt -lz
+//   ./bench [profiles|rudp|local|compress]   (no argument runs every section)
+//
+// Figures depend on the machine; compare rows within one run only.
+#include "FmxNet.hpp"
+#include "compress.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace fmx;
+
+namespace {
+    using bench_clock = std::chrono::steady_clock;
+
+    double elapsed_us(bench_clock::time_point since) {
+        return std::chrono::duration<double, std::micro>(bench_clock::now() - since).count();
+    }
+
+    // Collects per-operation latencies in microseconds.
+    struct Latency {
+        std::vector<double> samples;
+
+        void add(double us) { samples.push_back(us); }
+        double percentile(double p) {
+            if (samples.empty()) return 0;
+            std::sort(samples.begin(), samples.end());
+            size_t i = static_cast<size_t>(p / 100.0 * (samples.size() - 1) + 0.5);
+            return samples[i];
+        }
+    };
+
+    unsigned short next_port = 39500;
+
+    // ---- user-029: socket profiles -------------------------------------
+
+    // Small request/response round trips over one connection.
+    void rpc_round_trips(const char* name, const SocketProfile& profile) {
+        const int rounds = 20000;
+        const size_t size = 64;
+        unsigned short port = next_port++;
+        TcpServerIPv4 server;
+        server.set_profile(profile);
+        server.bind_port(port);
+        server.start_listen();
+        std::thread echo([&] {
+            auto conn = server.accept_client();
+            std::string request;
+            while (conn.recv_data(request, size) == static_cast<int>(size)) conn.send_data(request);
+        });
+        TcpIPv4 client;
+        client.set_profile(profile);
+        client.initTcp();
+        client.set_address("127.0.0.1", port);
+        client.connect_to_server();
+        std::string request(size, 'r'), reply;
+        Latency latency;
+        auto start = bench_clock::now();
+        for (int i = 0; i < rounds; ++i) {
+            auto t = bench_clock::now();
+            client.send_data(request);
+            client.recv_data(reply, size);
+            latency.add(elapsed_us(t));
+        }
+        double total = elapsed_us(start);
+        client.close_connection();
+        echo.join();
+        printf("  %-16s rpc %5zu B   %9.0f req/s   p50 %7.2f us   p99 %7.2f us\n",
+               name, size, rounds / (total / 1e6), latency.percentile(50), latency.percentile(99));
+    }
+
+    // New connection per request: connect_to_server + send_data, or
+    // connect_with_data when the profile enables Fast Open.
+    void connect_and_request(const char* name, const SocketProfile& profile) {
+        const int rounds = 2000;
+        unsigned short port = next_port++;
+        TcpServerIPv4 server;
+        server.set_profile(profile);
+        server.bind_port(port);
+        server.start_listen(256);
+        std::thread echo([&] {
+            for (int i = 0; i < rounds; ++i) {
+                auto conn = server.accept_client();
+                std::string request;
+                if (conn.recv_data(request, 16) == 16) conn.send_data(request);
+            }
+        });
+        std::string request(16, 'c'), reply;
+        Latency latency;
+        for (int i = 0; i < rounds; ++i) {
+            auto t = bench_clock::now();
+            TcpIPv4 client;
+            client.set_profile(profile);
+            client.initTcp();
+            client.set_address("127.0.0.1", port);
+            if (profile.fastopen_connect) {
+                client.connect_with_data(request);
+            } else {
+                client.connect_to_server();
+                client.send_data(request);
+            }
+            client.recv_data(reply, 16);
+            latency.add(elapsed_us(t));
+        }
+        echo.join();
+        printf("  %-16s connect+request          p50 %7.2f us   p99 %7.2f us\n",
+               name, latency.percentile(50), latency.percentile(99));
+    }
+
+    // One-way stream of large writes.
+    void bulk_stream(const char* name, const SocketProfile& profile) {
+        const size_t total = size_t(512) << 20;
+        const size_t chunk = 64 * 1024;
+        unsigned short port = next_port++;
+        TcpServerIPv4 server;
+        server.set_profile(profile);
+        server.bind_port(port);
+        server.start_listen();
+        std::thread sink([&] {
+            auto conn = server.accept_client();
+            std::vector<char> buffer(256 * 1024);
+            size_t received = 0;
+            while (received < total) {
+                int n = conn.recv_some(buffer.data(), buffer.size());
+                if (n <= 0) break;
+                received += n;
+            }
+        });
+        TcpIPv4 client;
+        client.set_profile(profile);
+        client.initTcp();
+        client.set_address("127.0.0.1", port);
+        client.connect_to_server();
+        std::string block(chunk, 'b');
+        auto start = bench_clock::now();
+        for (size_t sent = 0; sent < total; sent += chunk) client.send_data(block);
+        sink.join();
+        double total_us = elapsed_us(start);
+        client.close_connection();
+        printf("  %-16s bulk %4zu MB            %9.0f MB/s\n",
+               name, total >> 20, (total >> 20) / (total_us / 1e6));
+    }
+
+    void bench_profiles() {
+        printf("socket profiles (TCP loopback)\n");
+        const struct {
+            const char* name;
+            SocketProfile profile;
+        } profiles[] = {
+            { "default", SocketProfile() },
+            { "low_latency_rpc", SocketProfile::low_latency_rpc() },
+            { "bulk_transfer", SocketProfile::bulk_transfer() },
+        };
+        for (const auto& p : profiles) rpc_round_trips(p.name, p.profile);
+        for (const auto& p : profiles) connect_and_request(p.name, p.profile);
+        for (const auto& p : profiles) bulk_stream(p.name, p.profile);
+    }
+
+    // ---- user-031: reliable UDP under loss -----------------------------
+
+    // Fan-out stream: one sender, `fanout` receivers, `messages` small
+    // messages to each, sent as fast as the transport accepts them. Every message
+    // starts with its send time, so latency includes queueing under load.
+    const int fanout = 8;
+    const int messages = 5000;
+    const size_t message_size = 64;
+
+    std::string stamped_message() {
+        std::string m(message_size, 'm');
+        uint64_t ns = bench_clock::now().time_since_epoch().count();
+        memcpy(&m[0], &ns, sizeof(ns));
+        return m;
+    }
+    double message_age_us(const std::string& m) {
+        uint64_t ns = 0;
+        memcpy(&ns, m.data(), sizeof(ns));
+        return (bench_clock::now().time_since_epoch().count() - ns) / 1000.0;
+    }
+    void report_fanout(const char* name, double total_us, std::vector<Latency>& per_receiver, int delivered) {
+        Latency all;
+        for (auto& l : per_receiver) all.samples.insert(all.samples.end(), l.samples.begin(), l.samples.end());
+        printf("  %-16s %6d/%d msgs   %9.0f msg/s   p50 %9.1f us   p99 %9.1f us\n",
+               name, delivered, fanout * messages, delivered / (total_us / 1e6),
+               all.percentile(50), all.percentile(99));
+    }
+
+    void rudp_fanout(double loss) {
+        std::vector<std::unique_ptr<UdpIPv4>> tx_sockets, rx_sockets;
+        std::vector<std::unique_ptr<ReliableUdp<UdpIPv4>>> senders, receivers;
+        for (int k = 0; k < fanout; ++k) {
+            unsigned short port = next_port++;
+            rx_sockets.push_back(std::make_unique<UdpIPv4>());
+            rx_sockets.back()->initUdp();
+            rx_sockets.back()->bind_port(port);
+            tx_sockets.push_back(std::make_unique<UdpIPv4>());
+            tx_sockets.back()->initUdp();
+            tx_sockets.back()->set_address("127.0.0.1", port);
+            senders.push_back(std::make_unique<ReliableUdp<UdpIPv4>>(*tx_sockets.back()));
+            senders.back()->set_loss_rate(loss, 1 + k);
+            receivers.push_back(std::make_unique<ReliableUdp<UdpIPv4>>(*rx_sockets.back()));
+            receivers.back()->set_loss_rate(loss, 101 + k);
+            receivers.back()->set_timeout(100);
+        }
+        std::vector<Latency> latency(fanout);
+        std::atomic<int> delivered{0};
+        std::atomic<bool> done{false};
+        std::vector<std::thread> threads;
+        auto start = bench_clock::now();
+        for (int k = 0; k < fanout; ++k) {
+            threads.emplace_back([&, k] {
+                std::string m;
+                // RTO backoff can stall a receiver for seconds; keep waiting.
+                for (int i = 0; i < messages && !done;) {
+                    if (receivers[k]->recv_message(m) < 0) continue;
+                    latency[k].add(message_age_us(m));
+                    ++delivered;
+                    ++i;
+                }
+                // Keep acknowledging retransmissions until the sender is done.
+                while (!done) receivers[k]->pump(5);
+            });
+        }
+        for (int i = 0; i < messages; ++i)
+            for (int k = 0; k < fanout; ++k) senders[k]->send_message(stamped_message());
+        while (delivered < fanout * messages && elapsed_us(start) < 60e6) {
+            for (auto& s : senders)
+                if (s->pending() > 0) s->pump(0);
+            std::this_thread::yield();
+        }
+        double total_us = elapsed_us(start);
+        done = true;
+        for (auto& t : threads) t.join();
+        uint64_t retransmits = 0;
+        for (auto& s : senders) retransmits += s->get_stats().retransmits;
+        char name[32];
+        snprintf(name, sizeof(name), "rudp %2.0f%% loss", loss * 100);
+        report_fanout(name, total_us, latency, delivered);
+        printf("  %-16s retransmits %llu\n", "", static_cast<unsigned long long>(retransmits));
+    }
+
+    // Same stream over one TcpIPv4 connection per receiver. The kernel
+    // offers no loss injection without netem, so TCP runs loss-free.
+    void tcp_fanout() {
+        TcpServerIPv4 server;
+        unsigned short port = next_port++;
+        server.bind_port(port);
+        server.start_listen(fanout);
+        std::vector<std::unique_ptr<TcpIPv4>> clients;
+        std::vector<TcpIPv4> accepted(fanout);
+        for (int k = 0; k < fanout; ++k) {
+            clients.push_back(std::make_unique<TcpIPv4>());
+            clients.back()->initTcp();
+            clients.back()->set_address("127.0.0.1", port);
+            clients.back()->connect_to_server();
+            // Copies share the fd, so hand it over instead of copying.
+            auto conn = server.accept_client();
+            accepted[k].set_fd(conn.get_fd());
+            conn.set_fd(-1);
+        }
+        std::vector<Latency> latency(fanout);
+        std::atomic<int> delivered{0};
+        std::vector<std::thread> threads;
+        auto start = bench_clock::now();
+        for (int k = 0; k < fanout; ++k) {
+            threads.emplace_back([&, k] {
+                std::string m;
+                for (int i = 0; i < messages && accepted[k].recv_data(m, message_size) == static_cast<int>(message_size); ++i) {
+                    latency[k].add(message_age_us(m));
+                    ++delivered;
+                }
+            });
+        }
+        for (int i = 0; i < messages; ++i)
+            for (int k = 0; k < fanout; ++k) clients[k]->send_data(stamped_message());
+        for (auto& t : threads) t.join();
+        report_fanout("tcp (no loss)", elapsed_us(start), latency, delivered);
+    }
+
+    void bench_rudp() {
+        printf("reliable UDP vs TCP: %d receivers x %d messages of %zu B\n", fanout, messages, message_size);
+        tcp_fanout();
+        for (double loss : { 0.0, 0.1, 0.3 }) rudp_fanout(loss);
+    }
+
+    // ---- user-032: same-host transports --------------------------------
+
+    // Round trips between client and an echo loop on server, which must
+    // already be connected to each other.
+    template <typename Client, typename Server>
+    void ping_pong(const char* name, Client& client, Server& server, size_t size) {
+        const int rounds = 20000;
+        std::thread echo([&] {
+            std::string request;
+            while (server.recv_data(request, size) == static_cast<int>(size)) server.send_data(request);
+        });
+        std::string request(size, 'p'), reply;
+        Latency latency;
+        auto start = bench_clock::now();
+        for (int i = 0; i < rounds; ++i) {
+            auto t = bench_clock::now();
+            client.send_data(request);
+            client.recv_data(reply, size);
+            latency.add(elapsed_us(t));
+        }
+        double total = elapsed_us(start);
+        client.close_connection();
+        echo.join();
+        printf("  %-16s %5zu B   %9.0f rt/s   p50 %7.2f us   p99 %7.2f us\n",
+               name, size, rounds / (total / 1e6), latency.percentile(50), latency.percentile(99));
+    }
+
+    void bench_local() {
+        printf("same-host ping-pong\n");
+        for (size_t size : { size_t(64), size_t(4096) }) {
+            {
+                unsigned short port = next_port++;
+                TcpServerIPv4 listener;
+                listener.bind_port(port);
+                listener.start_listen();
+                TcpIPv4 client;
+                client.set_profile(SocketProfile::low_latency_rpc());
+                client.initTcp();
+                client.set_address("127.0.0.1", port);
+                client.connect_to_server();
+                auto server = listener.accept_client();
+                ping_pong("tcp loopback", client, server, size);
+            }
+            {
+                const char* path = "/tmp/fmx-bench.sock";
+                UnixStreamServer listener;
+                listener.bind_path(path);
+                listener.start_listen();
+                UnixStream client;
+                client.initTcp();
+                client.set_address(path, 0);
+                client.connect_to_server();
+                auto server = listener.accept_client();
+                ping_pong("UnixStream", client, server, size);
+            }
+            {
+                const char* segment = "/fmx-bench";
+                ShmChannel server;
+                server.create(segment, 1 << 16);
+                ShmChannel client;
+                client.set_address(segment, 0);
+                client.connect_to_server();
+                ping_pong("ShmChannel", client, server, size);
+            }
+        }
+    }
+
+    // ---- user-034: gzip CPU cost against bytes saved -------------------
+
+    std::string json_payload(size_t size) {
+        std::mt19937 rng(7);
+        std::string out = "[";
+        for (int i = 0; out.size() < size; ++i) {
+            out += "{\"id\":" + std::to_string(i) + ",\"name\":\"user-" + std::to_string(rng() % 100000) +
+                   "\",\"email\":\"user" + std::to_string(i) + "@example.com\",\"score\":" +
+                   std::to_string(rng() % 1000000 / 1000.0) + ",\"active\":" + (rng() & 1 ? "true" : "false") +
+                   ",\"tags\":[\"alpha\",\"beta\"]},";
+        }
+        out.back() = ']';
+        return out;
+    }
+    std::string random_payload(size_t size) {
+        std::mt19937 rng(7);
+        std::string out(size, '\0');
+        for (char& c : out) c = static_cast<char>(rng());
+        return out;
+    }
+
+    // Compresses body as a request and decodes it as a gzip response through
+    // ZlibCoding, so the figures come from its own CompressionStats.
+    // "break-even" is bytes saved per CPU second: on links slower than that,
+    // compressing and decompressing costs less time than sending the bytes.
+    void compress_level(const char* name, const std::string& body, int level) {
+        const int rounds = 10;
+        ZlibCoding coding;
+        CompressionOptions options;
+        options.request_coding = ContentCoding::Gzip;
+        options.level = level;
+        coding.set_options(options);
+        std::string wire, head, decoded;
+        const char* coded = nullptr;
+        for (int i = 0; i < rounds; ++i) coded = coding.encode_body("", body, wire);
+        if (!coded) {
+            printf("  %-8s level %d   not smaller, sent as-is after %7.2f ms of deflate\n",
+                   name, level, coding.get_stats().deflate_ns / 1e6 / rounds);
+            return;
+        }
+        std::string response = "HTTP/1.1 200 OK\r\nContent-Encoding: gzip\r\nContent-Length: " +
+                               std::to_string(wire.size()) + "\r\n\r\n" + wire;
+        auto sink = [&](const char* data, size_t size) { decoded.append(data, size); };
+        for (int i = 0; i < rounds; ++i) {
+            decoded.clear();
+            head.clear();
+            coding.begin_response();
+            // Fed in 16 KB reads, as receiveResponse would.
+            for (size_t offset = 0; offset < response.size(); offset += 16384)
+                coding.feed(response.data() + offset, std::min<size_t>(16384, response.size() - offset), head, sink);
+        }
+        const CompressionStats& stats = coding.get_stats();
+        double deflate_ms = stats.deflate_ns / 1e6 / rounds;
+        double inflate_ms = stats.inflate_ns / 1e6 / rounds;
+        double saved = static_cast<double>(body.size() - wire.size());
+        printf("  %-8s level %d   %8zu -> %8zu B (%4.1f%% saved)   deflate %6.2f ms   inflate %5.2f ms   "
+               "break-even %6.1f MB/s%s\n",
+               name, level, body.size(), wire.size(), 100.0 * saved / body.size(), deflate_ms, inflate_ms,
+               saved / 1e6 / ((deflate_ms + inflate_ms) / 1e3), decoded == body ? "" : "   MISMATCH");
+    }
+
+    void bench_compress() {
+        printf("gzip request/response coding, 1 MB bodies\n");
+        std::string json = json_payload(1 << 20);
+        for (int level : { 1, 6, 9 }) compress_level("json", json, level);
+        compress_level("random", random_payload(1 << 20), 6);
+    }
+}
+
+int main(int argc, char** argv) {
+    std::string only = argc > 1 ? argv[1] : "";
+    auto selected = [&](const char* section) { return only.empty() || only == section; };
+    if (selected("profiles")) bench_profiles();
+    if (selected("rudp")) bench_rudp();
+    if (selected("local")) bench_local();
+    if (selected("compress")) bench_compress();
+    return 0;
+}
@@ -0,0 +1,354 @@
+#if !defined(FMX_COMPRESS_HPP)
+#define FMX_COMPRESS_HPP
+
+// gzip/deflate content coding for HttpImpl. Requires zlib (link with -lz),
+// so FmxNet.hpp does not include it.
+#include "http.hpp"
+#include <strings.h>
+#include <zlib.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace fmx {
+    enum class ContentCoding {
+        Identity,
+        Gzip,
+        Deflate     // zlib-wrapped, as RFC 9110 defines it
+    };
+
+    struct CompressionOptions {
+        ContentCoding request_coding = ContentCoding::Identity;   // opt-in
+        size_t min_size = 1024;             // smaller request bodies are sent as-is
+        int level = Z_DEFAULT_COMPRESSION;
+        bool accept_encoding = true;        // advertise gzip/deflate for responses
+    };
+
+    // Bytes before/after coding and the time spent in zlib, to weigh the CPU
+    // cost against the bytes saved. Only coded bodies are counted.
+    struct CompressionStats {
+        uint64_t request_bytes = 0;
+        uint64_t request_wire_bytes = 0;
+        uint64_t response_wire_bytes = 0;
+        uint64_t response_bytes = 0;
+        uint64_t deflate_ns = 0;
+        uint64_t inflate_ns = 0;
+    };
+
+    namespace detail {
+        inline uint64_t elapsed_ns(std::chrono::steady_clock::time_point since) {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - since).count();
+        }
+    }
+
+    // Streaming compressor: output is appended as input slices are fed.
+    class Deflater {
+    private:
+        z_stream zs{};
+        bool active = false;
+    public:
+        Deflater() = default;
+        ~Deflater() { if (active) deflateEnd(&zs); }
+        Deflater(const Deflater&) = delete;
+        Deflater& operator=(const Deflater&) = delete;
+
+        int init(ContentCoding coding, int level = Z_DEFAULT_COMPRESSION) {
+            if (active) deflateEnd(&zs);
+            zs = z_stream{};
+            int window_bits = coding == ContentCoding::Gzip ? 15 + 16 : 15;
+            active = deflateInit2(&zs, level, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+            return active ? 0 : -1;
+        }
+        // Compresses data into out; finish terminates the stream.
+        int update(const char* data, size_t length, std::string& out, bool finish) {
+            if (!active) return -1;
+            zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+            zs.avail_in = static_cast<uInt>(length);
+            int ret;
+            do {
+                size_t used = out.size();
+                size_t room = std::max<size_t>(deflateBound(&zs, zs.avail_in), 4096);
+                out.resize(used + room);
+                zs.next_out = reinterpret_cast<Bytef*>(&out[used]);
+                zs.avail_out = static_cast<uInt>(room);
+                ret = deflate(&zs, finish ? Z_FINISH : Z_NO_FLUSH);
+                out.resize(used + room - zs.avail_out);
+                if (ret == Z_STREAM_ERROR) return -1;
+            } while (zs.avail_out == 0 || (finish && ret != Z_STREAM_END));
+            return 0;
+        }
+    };
+
+    // Streaming decompressor handing output to a sink in 16 KB pieces.
+    class Inflater {
+    private:
+        z_stream zs{};
+        ContentCoding coding = ContentCoding::Identity;
+        bool active = false;
+        bool finished = false;
+        uint64_t inflate_ns = 0;
+
+        void end() {
+            if (active) inflateEnd(&zs);
+            active = false;
+        }
+    public:
+        Inflater() = default;
+        ~Inflater() { end(); }
+        Inflater(const Inflater&) = delete;
+        Inflater& operator=(const Inflater&) = delete;
+
+        // The zlib stream is set up on the first byte, see update().
+        void init(ContentCoding c) {
+            end();
+            coding = c;
+            finished = false;
+        }
+        bool done() const { return finished; }
+        // Time spent inside zlib's inflate() so far, excluding the sink.
+        uint64_t get_inflate_ns() const { return inflate_ns; }
+
+        // Returns -1 on corrupt input. Bytes after the end of the stream are ignored.
+        template <typename Sink>
+        int update(const char* data, size_t length, Sink&& sink) {
+            if (finished || length == 0) return 0;
+            if (!active) {
+                int window_bits = 15 + 16;
+                if (coding == ContentCoding::Deflate) {
+                    // Some servers send raw deflate despite the zlib requirement.
+                    unsigned char cmf = static_cast<unsigned char>(data[0]);
+                    window_bits = (cmf & 0x0f) == Z_DEFLATED && (cmf >> 4) <= 7 ? 15 : -15;
+                }
+                zs = z_stream{};
+                if (inflateInit2(&zs, window_bits) != Z_OK) return -1;
+                active = true;
+            }
+            zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+            zs.avail_in = static_cast<uInt>(length);
+            char buffer[16384];
+            do {
+                zs.next_out = reinterpret_cast<Bytef*>(buffer);
+                zs.avail_out = sizeof(buffer);
+                auto start = std::chrono::steady_clock::now();
+                int ret = inflate(&zs, Z_NO_FLUSH);
+                inflate_ns += detail::elapsed_ns(start);
+                if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) return -1;
+                size_t produced = sizeof(buffer) - zs.avail_out;
+                if (produced) sink(buffer, produced);
+                if (ret == Z_STREAM_END) {
+                    finished = true;
+                    break;
+                }
+                if (ret == Z_BUF_ERROR) break;
+            } while (zs.avail_in > 0 || zs.avail_out == 0);
+            return 0;
+        }
+    };
+
+    // Content-coding policy for HttpImpl: opt-in request body compression
+    // and streaming decoding of gzip/deflate responses, including chunked
+    // transfer coding. Decoded responses lose the Content-Encoding,
+    // Content-Length and Transfer-Encoding fields they no longer match.
+    class ZlibCoding {
+    private:
+        enum class State { Head, ChunkSize, ChunkData, ChunkEnd, Trailers, Body, Done };
+
+        CompressionOptions options;
+        CompressionStats stats;
+        Deflater deflater;
+        Inflater inflater;
+        State state = State::Head;
+        ContentCoding response_coding = ContentCoding::Identity;
+        uint64_t chunk_left = 0;
+        std::string line;       // partial head, chunk-size or trailer line
+
+        static const char* coding_name(ContentCoding coding) {
+            return coding == ContentCoding::Gzip ? "gzip" : "deflate";
+        }
+        static bool has_field(const std::string& headers, const char* name) {
+            size_t n = strlen(name);
+            for (size_t pos = 0; pos < headers.size();) {
+                if (strncasecmp(headers.c_str() + pos, name, n) == 0 && headers[pos + n] == ':') return true;
+                pos = headers.find('\n', pos);
+                if (pos == std::string::npos) break;
+                ++pos;
+            }
+            return false;
+        }
+
+        // Parses the response head and copies it to out, minus the fields
+        // describing framing and coding this decoder removes.
+        void parse_head(const std::string& raw, std::string& out) {
+            response_coding = ContentCoding::Identity;
+            bool chunked = false;
+            bool coded = false;
+            size_t pos = raw.find("\r\n") + 2;
+            int status = raw.size() > 12 ? std::atoi(raw.c_str() + 9) : 0;
+            for (size_t eol; (eol = raw.find("\r\n", pos)) != std::string::npos && eol > pos; pos = eol + 2) {
+                size_t colon = raw.find(':', pos);
+                if (colon > eol) continue;
+                const char* field = raw.c_str() + pos;
+                const char* value = raw.c_str() + std::min(raw.find_first_not_of(" \t", colon + 1), eol);
+                if (strncasecmp(field, "content-encoding:", 17) == 0) {
+                    if (strncasecmp(value, "gzip", 4) == 0 || strncasecmp(value, "x-gzip", 6) == 0) {
+                        response_coding = ContentCoding::Gzip;
+                    } else if (strncasecmp(value, "deflate", 7) == 0) {
+                        response_coding = ContentCoding::Deflate;
+                    }
+                    coded = response_coding != ContentCoding::Identity;
+                } else if (strncasecmp(field, "transfer-encoding:", 18) == 0) {
+                    chunked = strcasestr(value, "chunked") != nullptr;
+                }
+            }
+            if (status >= 100 && status < 200) {
+                // Interim response; the real head follows.
+                out += raw;
+                return;
+            }
+            pos = 0;
+            for (size_t eol; (eol = raw.find("\r\n", pos)) != std::string::npos; pos = eol + 2) {
+                const char* field = raw.c_str() + pos;
+                bool drop = (coded && (strncasecmp(field, "content-encoding:", 17) == 0 ||
+                                       strncasecmp(field, "content-length:", 15) == 0)) ||
+                            (chunked && strncasecmp(field, "transfer-encoding:", 18) == 0);
+                if (!drop) out.append(raw, pos, eol + 2 - pos);
+            }
+            if (coded) inflater.init(response_coding);
+            state = chunked ? State::ChunkSize : State::Body;
+        }
+        template <typename Sink>
+        int deliver(const char* data, size_t length, Sink& sink) {
+            if (response_coding == ContentCoding::Identity) {
+                sink(data, length);
+                return 0;
+            }
+            stats.response_wire_bytes += length;
+            uint64_t before = inflater.get_inflate_ns();
+            int ret = inflater.update(data, length, [&](const char* out, size_t size) {
+                stats.response_bytes += size;
+                sink(out, size);
+            });
+            stats.inflate_ns += inflater.get_inflate_ns() - before;
+            return ret;
+        }
+        // Collects one CRLF-terminated line into line. Returns true once complete.
+        bool take_line(const char*& data, const char* end) {
+            const char* eol = static_cast<const char*>(memchr(data, '\n', end - data));
+            const char* stop = eol ? eol + 1 : end;
+            line.append(data, stop);
+            data = stop;
+            return eol != nullptr;
+        }
+    public:
+        static constexpr bool enabled = true;
+
+        void set_options(const CompressionOptions& o) { options = o; }
+        const CompressionOptions& get_options() const { return options; }
+        const CompressionStats& get_stats() const { return stats; }
+
+        void add_request_headers(std::string& request) const {
+            if (options.accept_encoding) request += "Accept-Encoding: gzip, deflate\r\n";
+        }
+        // Compresses body into out in 64 KB slices. Returns the coding name,
+        // or nullptr to send the body as-is: coding disabled, body below the
+        // threshold, already coded by the caller, or not made smaller.
+        const char* encode_body(const std::string& headers, const std::string& body, std::string& out) {
+            if (options.request_coding == ContentCoding::Identity || body.size() < options.min_size ||
+                has_field(headers, "Content-Encoding"))
+                return nullptr;
+            auto start = std::chrono::steady_clock::now();
+            if (deflater.init(options.request_coding, options.level) < 0) return nullptr;
+            out.clear();
+            const size_t slice = 64 * 1024;
+            for (size_t offset = 0; offset < body.size(); offset += slice) {
+                size_t n = std::min(slice, body.size() - offset);
+                if (deflater.update(body.data() + offset, n, out, offset + n == body.size()) < 0) return nullptr;
+            }
+            stats.deflate_ns += detail::elapsed_ns(start);
+            if (out.size() >= body.size()) return nullptr;
+            stats.request_bytes += body.size();
+            stats.request_wire_bytes += out.size();
+            return coding_name(options.request_coding);
+        }
+
+        void begin_response() {
+            state = State::Head;
+            response_coding = ContentCoding::Identity;
+            line.clear();
+        }
+        // Feeds received bytes: the head is appended to head, the decoded
+        // body handed to sink(data, size). Returns -1 on malformed input.
+        template <typename Sink>
+        int feed(const char* data, size_t length, std::string& head, Sink& sink) {
+            const char* end = data + length;
+            while (data < end) {
+                switch (state) {
+                case State::Head: {
+                    size_t searched = line.size() >= 3 ? line.size() - 3 : 0;
+                    line.append(data, end);
+                    size_t pos = line.find("\r\n\r\n", searched);
+                    if (pos == std::string::npos) return 0;
+                    data = end - (line.size() - pos - 4);
+                    std::string raw = line.substr(0, pos + 4);
+                    line.clear();
+                    parse_head(raw, head);
+                    break;
+                }
+                case State::ChunkSize:
+                    if (!take_line(data, end)) return 0;
+                    if (line.empty() || !isxdigit(static_cast<unsigned char>(line[0]))) return -1;
+                    chunk_left = strtoull(line.c_str(), nullptr, 16);
+                    line.clear();
+                    state = chunk_left ? State::ChunkData : State::Trailers;
+                    break;
+                case State::ChunkData: {
+                    size_t n = std::min<uint64_t>(chunk_left, end - data);
+                    if (deliver(data, n, sink) < 0) return -1;
+                    data += n;
+                    chunk_left -= n;
+                    if (chunk_left == 0) state = State::ChunkEnd;
+                    break;
+                }
+                case State::ChunkEnd:
+                    if (!take_line(data, end)) return 0;
+                    line.clear();
+                    state = State::ChunkSize;
+                    break;
+                case State::Trailers:
+                    if (!take_line(data, end)) return 0;
+                    state = line == "\r\n" || line == "\n" ? State::Done : State::Trailers;
+                    line.clear();
+                    break;
+                case State::Body:
+                    if (deliver(data, end - data, sink) < 0) return -1;
+                    return 0;
+                case State::Done:
+                    return 0;
+                }
+            }
+            return 0;
+        }
+    };
+
+    class Httpv4Zlib : public HttpImpl<TcpIPv4, ZlibCoding> {
+    public:
+        Httpv4Zlib() = default;
+    };
+
+    class Httpv6Zlib : public HttpImpl<TcpIPv6, ZlibCoding> {
+    public:
+        Httpv6Zlib() = default;
+    };
+
+    class HttpDualStackZlib : public HttpImpl<TcpDualStack, ZlibCoding> {
+    public:
+        HttpDualStackZlib() = default;
+    };
+}
+
+#endif // FMX_COMPRESS_HPP
@@ -0,0 +1,207 @@
+#if !defined(FMX_DUALSTACK_HPP)
+#define FMX_DUALSTACK_HPP
+
+#include "tcp.hpp"
+#include <poll.h>
+#include <sys/socket.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace fmx {
+    // Address-family agnostic TCP client. connect_to_server() resolves both
+    // IPv6 and IPv4 and races staggered non-blocking connects (Happy Eyeballs,
+    // RFC 8305); the first socket to complete wins and the rest are closed.
+    class TcpDualStack : public TcpBase {
+    public:
+        void set_fd(int fd) { socket_fd = fd; }
+    private:
+        struct Candidate {
+            struct sockaddr_storage addr;
+            socklen_t len;
+        };
+        std::string host;
+        int port = 0;
+        unsigned long long attempt_delay = 250;
+        struct sockaddr_storage peer_addr{};
+        socklen_t peer_len = 0;
+
+        // Alternates address families, starting with whichever the resolver
+        // preferred (RFC 8305 section 4).
+        static std::vector<Candidate> interleave(const std::vector<Candidate>& sorted) {
+            std::vector<Candidate> first, second, out;
+            if (sorted.empty()) return out;
+            int first_family = sorted[0].addr.ss_family;
+            for (const auto& c : sorted)
+                (c.addr.ss_family == first_family ? first : second).push_back(c);
+            for (size_t i = 0; i < first.size() || i < second.size(); ++i) {
+                if (i < first.size()) out.push_back(first[i]);
+                if (i < second.size()) out.push_back(second[i]);
+            }
+            return out;
+        }
+        int resolve(std::vector<Candidate>& out) const {
+            struct addrinfo hints{}, *res;
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            hints.ai_flags = AI_NUMERICSERV | AI_ADDRCONFIG;
+            std::string service = std::to_string(port);
+            if (getaddrinfo(host.c_str(), service.c_str(), &hints, &res) != 0) return -1;
+            std::vector<Candidate> sorted;
+            for (struct addrinfo* ai = res; ai; ai = ai->ai_next) {
+                Candidate c{};
+                memcpy(&c.addr, ai->ai_addr, ai->ai_addrlen);
+                c.len = ai->ai_addrlen;
+                sorted.push_back(c);
+            }
+            freeaddrinfo(res);
+            out = interleave(sorted);
+            return out.empty() ? -1 : 0;
+        }
+        int race(const std::vector<Candidate>& candidates) {
+            using clock = std::chrono::steady_clock;
+            auto start = clock::now();
+            auto deadline = start + std::chrono::milliseconds(time_out);
+            auto next_attempt = start;
+            std::vector<struct pollfd> pending;
+            std::vector<size_t> owner;
+            size_t next = 0;
+            int winner = -1;
+            size_t winner_index = 0;
+
+            while (winner < 0) {
+                auto now = clock::now();
+                if (time_out > 0 && now >= deadline) break;
+                // Start the next attempt when its stagger delay expired or when
+                // nothing else is in flight.
+                if (next < candidates.size() && (now >= next_attempt || pending.empty())) {
+                    const Candidate& c = candidates[next];
+                    bool in_flight = false;
+                    int fd = socket(c.addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+                    if (fd >= 0) {
+                        // Fast Open is left out: a deferred SYN would make every
+                        // attempt "complete" immediately and defeat the race.
+                        apply_socket_profile(fd, profile);
+                        int ret = connect(fd, reinterpret_cast<const struct sockaddr*>(&c.addr), c.len);
+                        if (ret == 0) {
+                            winner = fd;
+                            winner_index = next;
+                        } else if (errno == EINPROGRESS) {
+                            pending.push_back({ fd, POLLOUT, 0 });
+                            owner.push_back(next);
+                            in_flight = true;
+                        } else {
+                            close(fd);
+                        }
+                    }
+                    ++next;
+                    // Like an asynchronous failure, an attempt that failed right
+                    // away (socket() or e.g. ENETUNREACH) does not hold up the next.
+                    next_attempt = clock::now();
+                    if (in_flight) next_attempt += std::chrono::milliseconds(attempt_delay);
+                    continue;
+                }
+                if (pending.empty()) break;
+
+                long long wait_ms = -1;
+                if (next < candidates.size())
+                    wait_ms = std::chrono::duration_cast<std::chrono::milliseconds>(next_attempt - now).count();
+                if (time_out > 0) {
+                    long long left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count();
+                    if (wait_ms < 0 || left < wait_ms) wait_ms = left;
+                }
+                if (wait_ms >= 0 && wait_ms < 1) wait_ms = 1;
+                int ready = poll(pending.data(), pending.size(), static_cast<int>(wait_ms));
+                if (ready < 0 && errno != EINTR) break;
+                for (size_t i = 0; ready > 0 && i < pending.size();) {
+                    if (pending[i].revents == 0) {
+                        ++i;
+                        continue;
+                    }
+                    int so_error = 0;
+                    socklen_t len = sizeof(so_error);
+                    getsockopt(pending[i].fd, SOL_SOCKET, SO_ERROR, &so_error, &len);
+                    if (so_error == 0 && winner < 0) {
+                        winner = pending[i].fd;
+                        winner_index = owner[i];
+                    } else {
+                        close(pending[i].fd);
+                        // A failed attempt lets the next one start right away.
+                        next_attempt = clock::now();
+                    }
+                    pending.erase(pending.begin() + i);
+                    owner.erase(owner.begin() + i);
+                }
+            }
+            for (const auto& p : pending) close(p.fd);
+            if (winner < 0) return -1;
+
+            int flags = fcntl(winner, F_GETFL, 0);
+            fcntl(winner, F_SETFL, flags & ~O_NONBLOCK);
+            socket_fd = winner;
+            peer_addr = candidates[winner_index].addr;
+            peer_len = candidates[winner_index].len;
+            return 0;
+        }
+    public:
+        TcpDualStack() = default;
+        ~TcpDualStack() override = default;
+
+        // Sockets are created per attempt in connect_to_server().
+        int initTcp() { return 0; }
+        // Accepts host names as well as IPv4/IPv6 literals.
+        int set_address(const char* host_name, int p) {
+            if (!host_name || !*host_name) return -1;
+            host = host_name;
+            port = p;
+            return 0;
+        }
+        // Delay between starting successive attempts (RFC 8305 recommends 250 ms).
+        void set_attempt_delay(unsigned long long ms) { attempt_delay = ms; }
+
+        // Races the resolved addresses; time_out bounds the whole race.
+        int connect_to_server() {
+            if (socket_fd >= 0) close_connection();
+            std::vector<Candidate> candidates;
+            if (resolve(candidates) < 0) return -1;
+            return race(candidates);
+        }
+        // Races an explicit list of IPv4/IPv6 literals in the given order.
+        int connect_to_any(const std::vector<std::string>& ips, int p) {
+            if (socket_fd >= 0) close_connection();
+            std::vector<Candidate> candidates;
+            for (const auto& ip : ips) {
+                Candidate c{};
+                auto* v4 = reinterpret_cast<struct sockaddr_in*>(&c.addr);
+                auto* v6 = reinterpret_cast<struct sockaddr_in6*>(&c.addr);
+                if (inet_pton(AF_INET, ip.c_str(), &v4->sin_addr) == 1) {
+                    v4->sin_family = AF_INET;
+                    v4->sin_port = htons(p);
+                    c.len = sizeof(struct sockaddr_in);
+                } else if (inet_pton(AF_INET6, ip.c_str(), &v6->sin6_addr) == 1) {
+                    v6->sin6_family = AF_INET6;
+                    v6->sin6_port = htons(p);
+                    c.len = sizeof(struct sockaddr_in6);
+                } else {
+                    continue;
+                }
+                candidates.push_back(c);
+            }
+            if (candidates.empty()) return -1;
+            return race(candidates);
+        }
+
+        // Chosen per connection, so generic code sees AF_UNSPEC.
+        static constexpr int get_address_family() { return AF_UNSPEC; }
+        // Family of the winning connection, AF_UNSPEC before connecting.
+        int get_connected_family() const { return peer_len ? peer_addr.ss_family : AF_UNSPEC; }
+        const struct sockaddr* get_peer_addr() const {
+            return reinterpret_cast<const struct sockaddr*>(&peer_addr);
+        }
+        socklen_t get_addr_len() const { return peer_len; }
+    };
+}
+
+#endif // FMX_DUALSTACK_HPP
@@ -0,0 +1,258 @@
+#if !defined(FMX_FRAMING_HPP)
+#define FMX_FRAMING_HPP
+
+#include "tcp.hpp"
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace fmx {
+    // Receive buffer whose storage is mapped twice back to back, so both the
+    // readable and the writable region are always contiguous. Falls back to a
+    // plain heap buffer (compacted on demand) when memfd is unavailable.
+    class RingBuffer {
+    private:
+        char* base = nullptr;
+        size_t capacity = 0;
+        size_t head = 0;
+        size_t size = 0;
+        bool mirrored = false;
+
+        static size_t round_to_page(size_t n) {
+            size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+            return (n + page - 1) / page * page;
+        }
+        int map_mirrored(size_t cap) {
+            int fd = memfd_create("fmx_ring", MFD_CLOEXEC);
+            if (fd < 0) return -1;
+            if (ftruncate(fd, cap) < 0) {
+                close(fd);
+                return -1;
+            }
+            void* area = mmap(nullptr, cap * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (area == MAP_FAILED) {
+                close(fd);
+                return -1;
+            }
+            char* p = static_cast<char*>(area);
+            if (mmap(p, cap, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+                mmap(p + cap, cap, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+                munmap(area, cap * 2);
+                close(fd);
+                return -1;
+            }
+            close(fd);
+            base = p;
+            return 0;
+        }
+        void release() {
+            if (!base) return;
+            if (mirrored) munmap(base, capacity * 2);
+            else free(base);
+            base = nullptr;
+        }
+    public:
+        RingBuffer() = default;
+        ~RingBuffer() { release(); }
+        RingBuffer(const RingBuffer&) = delete;
+        RingBuffer& operator=(const RingBuffer&) = delete;
+
+        int init(size_t min_capacity) {
+            release();
+            size_t cap = round_to_page(min_capacity ? min_capacity : 1);
+            head = size = 0;
+            mirrored = map_mirrored(cap) == 0;
+            if (!mirrored) {
+                base = static_cast<char*>(malloc(cap));
+                if (!base) return -1;
+            }
+            capacity = cap;
+            return 0;
+        }
+        // Grows to at least min_capacity, keeping the unread bytes.
+        int reserve(size_t min_capacity) {
+            if (min_capacity <= capacity) return 0;
+            RingBuffer bigger;
+            if (bigger.init(min_capacity) < 0) return -1;
+            memcpy(bigger.write_ptr(), read_ptr(), size);
+            bigger.commit(size);
+            std::swap(base, bigger.base);
+            std::swap(capacity, bigger.capacity);
+            std::swap(head, bigger.head);
+            std::swap(size, bigger.size);
+            std::swap(mirrored, bigger.mirrored);
+            return 0;
+        }
+
+        const char* read_ptr() const { return base + head; }
+        size_t readable() const { return size; }
+        void consume(size_t n) {
+            size -= n;
+            head = size == 0 ? 0 : (head + n) % capacity;
+        }
+
+        char* write_ptr() {
+            if (!mirrored && head + size == capacity && head > 0) {
+                memmove(base, base + head, size);
+                head = 0;
+            }
+            return base + (mirrored ? (head + size) % capacity : head + size);
+        }
+        size_t writable() const { return mirrored ? capacity - size : capacity - head - size; }
+        void commit(size_t n) { size += n; }
+        size_t get_capacity() const { return capacity; }
+    };
+
+    enum class FrameFormat {
+        FixedU32,   // 4-byte big-endian length
+        Varint      // LEB128 length, 1-5 bytes
+    };
+
+    // Length-prefixed message framing over any TcpBase stream. Each recv pulls
+    // as many bytes as are available into a per-connection ring, so one syscall
+    // can yield many frames. Returned views stay valid until the next recv call.
+    // Transport is deduced from the constructor argument, so wrappers that hide
+    // send_data/recv_some (e.g. Recorded<TcpIPv4>) see the framed traffic.
+    template <typename Transport = TcpBase>
+    class FrameCodec {
+    private:
+        Transport& tcp;
+        FrameFormat format;
+        size_t max_frame;
+        RingBuffer ring;
+        size_t pending_consume = 0;
+
+        // Returns 1 and fills header/body lengths if a full prefix is buffered,
+        // 0 if more bytes are needed, -1 on a malformed or oversized prefix.
+        int parse_prefix(const unsigned char* p, size_t avail, size_t& header, size_t& body) const {
+            if (format == FrameFormat::FixedU32) {
+                if (avail < 4) return 0;
+                body = (size_t(p[0]) << 24) | (size_t(p[1]) << 16) | (size_t(p[2]) << 8) | size_t(p[3]);
+                header = 4;
+            } else {
+                uint64_t value = 0;
+                size_t i = 0;
+                for (;; ++i) {
+                    if (i == 5) return -1;
+                    if (i == avail) return 0;
+                    value |= uint64_t(p[i] & 0x7f) << (7 * i);
+                    if (!(p[i] & 0x80)) break;
+                }
+                header = i + 1;
+                body = static_cast<size_t>(value);
+            }
+            return body > max_frame ? -1 : 1;
+        }
+        // Extracts one complete frame from the ring without touching the socket.
+        int next_buffered(std::string_view& frame) {
+            size_t header = 0, body = 0;
+            int ret = parse_prefix(reinterpret_cast<const unsigned char*>(ring.read_ptr()),
+                                   ring.readable(), header, body);
+            if (ret <= 0) return ret;
+            if (ring.readable() < header + body) {
+                if (ring.reserve(header + body) < 0) return -1;
+                return 0;
+            }
+            frame = std::string_view(ring.read_ptr() + header, body);
+            pending_consume = header + body;
+            return 1;
+        }
+        int fill() {
+            if (ring.get_capacity() == 0 && ring.init(64 * 1024) < 0) return -1;
+            char* dst = ring.write_ptr();
+            if (ring.writable() == 0) {
+                if (ring.reserve(ring.get_capacity() * 2) < 0) return -1;
+                dst = ring.write_ptr();
+            }
+            errno = 0;
+            int n = tcp.recv_some(dst, ring.writable());
+            // Packet transports (UnixSeqpacket) refuse to truncate a packet
+            // that does not fit; make room for it and retry.
+            while (n < 0 && errno == EMSGSIZE && ring.get_capacity() <= max_frame + 5) {
+                if (ring.reserve(ring.get_capacity() * 2) < 0) return -1;
+                dst = ring.write_ptr();
+                errno = 0;
+                n = tcp.recv_some(dst, ring.writable());
+            }
+            if (n <= 0) return -1;
+            ring.commit(n);
+            return n;
+        }
+        void release_pending() {
+            ring.consume(pending_consume);
+            pending_consume = 0;
+        }
+    public:
+        FrameCodec(Transport& tcp, FrameFormat format = FrameFormat::FixedU32, size_t max_frame = 16u << 20)
+            : tcp(tcp), format(format), max_frame(max_frame) {}
+
+        int init(size_t buffer_size = 64 * 1024) { return ring.init(buffer_size); }
+
+        // Appends the length prefix and payload to out, so callers can batch
+        // several frames into a single send_data.
+        static void encode_frame(std::string& out, std::string_view payload, FrameFormat format) {
+            uint32_t n = static_cast<uint32_t>(payload.size());
+            if (format == FrameFormat::FixedU32) {
+                char prefix[4] = { char(n >> 24), char(n >> 16), char(n >> 8), char(n) };
+                out.append(prefix, 4);
+            } else {
+                while (n >= 0x80) {
+                    out.push_back(char((n & 0x7f) | 0x80));
+                    n >>= 7;
+                }
+                out.push_back(char(n));
+            }
+            out.append(payload.data(), payload.size());
+        }
+        int send_frame(std::string_view payload) {
+            if (payload.size() > max_frame) return -1;
+            std::string out;
+            out.reserve(payload.size() + 5);
+            encode_frame(out, payload, format);
+            return tcp.send_data(out);
+        }
+
+        // Blocks until one full frame is available. Returns its size or -1.
+        int recv_frame(std::string_view& frame) {
+            release_pending();
+            for (;;) {
+                int ret = next_buffered(frame);
+                if (ret < 0) return -1;
+                if (ret > 0) return static_cast<int>(frame.size());
+                if (fill() < 0) return -1;
+            }
+        }
+
+        // Performs at most one recv and hands every complete frame to on_frame.
+        // Returns the number of frames delivered or -1 on error/close.
+        template <typename Fn>
+        int recv_frames(Fn&& on_frame) {
+            release_pending();
+            std::string_view frame;
+            int ret = next_buffered(frame);
+            if (ret < 0) return -1;
+            if (ret == 0 && fill() < 0) return -1;
+            int count = 0;
+            for (;;) {
+                if (pending_consume == 0) {
+                    ret = next_buffered(frame);
+                    if (ret < 0) return -1;
+                    if (ret == 0) break;
+                }
+                on_frame(frame);
+                release_pending();
+                ++count;
+            }
+            return count;
+        }
+
+        size_t buffered() const { return ring.readable() - pending_consume; }
+    };
+}
+
+#endif // FMX_FRAMING_HPP
@@ -0,0 +1,296 @@
+#if !defined(FMX_HPACK_HPP)
+#define FMX_HPACK_HPP
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace fmx {
+    // HPACK header compression (RFC 7541) used by Http2Client.
+    namespace hpack {
+        struct Header {
+            std::string name;
+            std::string value;
+        };
+
+        struct StaticEntry {
+            const char* name;
+            const char* value;
+        };
+
+        inline constexpr StaticEntry static_table[61] = {
+            { ":authority", "" }, { ":method", "GET" }, { ":method", "POST" }, { ":path", "/" },
+            { ":path", "/index.html" }, { ":scheme", "http" }, { ":scheme", "https" }, { ":status", "200" },
+            { ":status", "204" }, { ":status", "206" }, { ":status", "304" }, { ":status", "400" },
+            { ":status", "404" }, { ":status", "500" }, { "accept-charset", "" }, { "accept-encoding", "gzip, deflate" },
+            { "accept-language", "" }, { "accept-ranges", "" }, { "accept", "" }, { "access-control-allow-origin", "" },
+            { "age", "" }, { "allow", "" }, { "authorization", "" }, { "cache-control", "" },
+            { "content-disposition", "" }, { "content-encoding", "" }, { "content-language", "" }, { "content-length", "" },
+            { "content-location", "" }, { "content-range", "" }, { "content-type", "" }, { "cookie", "" },
+            { "date", "" }, { "etag", "" }, { "expect", "" }, { "expires", "" },
+            { "from", "" }, { "host", "" }, { "if-match", "" }, { "if-modified-since", "" },
+            { "if-none-match", "" }, { "if-range", "" }, { "if-unmodified-since", "" }, { "last-modified", "" },
+            { "link", "" }, { "location", "" }, { "max-forwards", "" }, { "proxy-authenticate", "" },
+            { "proxy-authorization", "" }, { "range", "" }, { "referer", "" }, { "refresh", "" },
+            { "retry-after", "" }, { "server", "" }, { "set-cookie", "" }, { "strict-transport-security", "" },
+            { "transfer-encoding", "" }, { "user-agent", "" }, { "vary", "" }, { "via", "" },
+            { "www-authenticate", "" },
+        };
+
+        // Appendix B: right-aligned code and bit length of every octet.
+        inline constexpr uint32_t huffman_codes[256] = {
+            0x1ff8, 0x7fffd8, 0xfffffe2, 0xfffffe3, 0xfffffe4, 0xfffffe5, 0xfffffe6, 0xfffffe7,
+            0xfffffe8, 0xffffea, 0x3ffffffc, 0xfffffe9, 0xfffffea, 0x3ffffffd, 0xfffffeb, 0xfffffec,
+            0xfffffed, 0xfffffee, 0xfffffef, 0xffffff0, 0xffffff1, 0xffffff2, 0x3ffffffe, 0xffffff3,
+            0xffffff4, 0xffffff5, 0xffffff6, 0xffffff7, 0xffffff8, 0xffffff9, 0xffffffa, 0xffffffb,
+            0x14, 0x3f8, 0x3f9, 0xffa, 0x1ff9, 0x15, 0xf8, 0x7fa,
+            0x3fa, 0x3fb, 0xf9, 0x7fb, 0xfa, 0x16, 0x17, 0x18,
+            0x0, 0x1, 0x2, 0x19, 0x1a, 0x1b, 0x1c, 0x1d,
+            0x1e, 0x1f, 0x5c, 0xfb, 0x7ffc, 0x20, 0xffb, 0x3fc,
+            0x1ffa, 0x21, 0x5d, 0x5e, 0x5f, 0x60, 0x61, 0x62,
+            0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a,
+            0x6b, 0x6c, 0x6d, 0x6e, 0x6f, 0x70, 0x71, 0x72,
+            0xfc, 0x73, 0xfd, 0x1ffb, 0x7fff0, 0x1ffc, 0x3ffc, 0x22,
+            0x7ffd, 0x3, 0x23, 0x4, 0x24, 0x5, 0x25, 0x26,
+            0x27, 0x6, 0x74, 0x75, 0x28, 0x29, 0x2a, 0x7,
+            0x2b, 0x76, 0x2c, 0x8, 0x9, 0x2d, 0x77, 0x78,
+            0x79, 0x7a, 0x7b, 0x7ffe, 0x7fc, 0x3ffd, 0x1ffd, 0xffffffc,
+            0xfffe6, 0x3fffd2, 0xfffe7, 0xfffe8, 0x3fffd3, 0x3fffd4, 0x3fffd5, 0x7fffd9,
+            0x3fffd6, 0x7fffda, 0x7fffdb, 0x7fffdc, 0x7fffdd, 0x7fffde, 0xffffeb, 0x7fffdf,
+            0xffffec, 0xffffed, 0x3fffd7, 0x7fffe0, 0xffffee, 0x7fffe1, 0x7fffe2, 0x7fffe3,
+            0x7fffe4, 0x1fffdc, 0x3fffd8, 0x7fffe5, 0x3fffd9, 0x7fffe6, 0x7fffe7, 0xffffef,
+            0x3fffda, 0x1fffdd, 0xfffe9, 0x3fffdb, 0x3fffdc, 0x7fffe8, 0x7fffe9, 0x1fffde,
+            0x7fffea, 0x3fffdd, 0x3fffde, 0xfffff0, 0x1fffdf, 0x3fffdf, 0x7fffeb, 0x7fffec,
+            0x1fffe0, 0x1fffe1, 0x3fffe0, 0x1fffe2, 0x7fffed, 0x3fffe1, 0x7fffee, 0x7fffef,
+            0xfffea, 0x3fffe2, 0x3fffe3, 0x3fffe4, 0x7ffff0, 0x3fffe5, 0x3fffe6, 0x7ffff1,
+            0x3ffffe0, 0x3ffffe1, 0xfffeb, 0x7fff1, 0x3fffe7, 0x7ffff2, 0x3fffe8, 0x1ffffec,
+            0x3ffffe2, 0x3ffffe3, 0x3ffffe4, 0x7ffffde, 0x7ffffdf, 0x3ffffe5, 0xfffff1, 0x1ffffed,
+            0x7fff2, 0x1fffe3, 0x3ffffe6, 0x7ffffe0, 0x7ffffe1, 0x3ffffe7, 0x7ffffe2, 0xfffff2,
+            0x1fffe4, 0x1fffe5, 0x3ffffe8, 0x3ffffe9, 0xffffffd, 0x7ffffe3, 0x7ffffe4, 0x7ffffe5,
+            0xfffec, 0xfffff3, 0xfffed, 0x1fffe6, 0x3fffe9, 0x1fffe7, 0x1fffe8, 0x7ffff3,
+            0x3fffea, 0x3fffeb, 0x1ffffee, 0x1ffffef, 0xfffff4, 0xfffff5, 0x3ffffea, 0x7ffff4,
+            0x3ffffeb, 0x7ffffe6, 0x3ffffec, 0x3ffffed, 0x7ffffe7, 0x7ffffe8, 0x7ffffe9, 0x7ffffea,
+            0x7ffffeb, 0xffffffe, 0x7ffffec, 0x7ffffed, 0x7ffffee, 0x7ffffef, 0x7fffff0, 0x3ffffee,
+        };
+        inline constexpr uint8_t huffman_lengths[256] = {
+            13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+            28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+            6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+            5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+            13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+            7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+            15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+            6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+            20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+            24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+            22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+            21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+            26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+            19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+            20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+            26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+        };
+
+        inline void encode_integer(std::string& out, uint8_t flags, int prefix_bits, uint64_t value) {
+            uint64_t max_prefix = (1u << prefix_bits) - 1;
+            if (value < max_prefix) {
+                out.push_back(static_cast<char>(flags | value));
+                return;
+            }
+            out.push_back(static_cast<char>(flags | max_prefix));
+            value -= max_prefix;
+            while (value >= 128) {
+                out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+                value >>= 7;
+            }
+            out.push_back(static_cast<char>(value));
+        }
+
+        // Advances p past the integer. Returns -1 on truncated or oversized input.
+        inline int decode_integer(const uint8_t*& p, const uint8_t* end, int prefix_bits, uint64_t& value) {
+            if (p >= end) return -1;
+            uint64_t max_prefix = (1u << prefix_bits) - 1;
+            value = *p++ & max_prefix;
+            if (value < max_prefix) return 0;
+            for (int shift = 0; shift < 63; shift += 7) {
+                if (p >= end) return -1;
+                uint8_t b = *p++;
+                value += static_cast<uint64_t>(b & 0x7f) << shift;
+                if (!(b & 0x80)) return 0;
+            }
+            return -1;
+        }
+
+        // Binary decoding tree built once from the code table.
+        class HuffmanTree {
+        private:
+            struct Node {
+                int16_t child[2] = { -1, -1 };
+                int16_t symbol = -1;
+            };
+            std::vector<Node> nodes;
+        public:
+            HuffmanTree() {
+                nodes.reserve(512);
+                nodes.emplace_back();
+                for (int sym = 0; sym < 256; ++sym) {
+                    size_t n = 0;
+                    for (int bit = huffman_lengths[sym] - 1; bit >= 0; --bit) {
+                        int b = (huffman_codes[sym] >> bit) & 1;
+                        if (nodes[n].child[b] < 0) {
+                            nodes[n].child[b] = static_cast<int16_t>(nodes.size());
+                            nodes.emplace_back();
+                        }
+                        n = nodes[n].child[b];
+                    }
+                    nodes[n].symbol = static_cast<int16_t>(sym);
+                }
+            }
+            static const HuffmanTree& instance() {
+                static const HuffmanTree tree;
+                return tree;
+            }
+            // Padding must be a prefix of EOS (all ones) no longer than 7 bits.
+            int decode(const uint8_t* p, size_t len, std::string& out) const {
+                int n = 0;
+                int depth = 0;
+                bool all_ones = true;
+                for (size_t i = 0; i < len; ++i) {
+                    for (int bit = 7; bit >= 0; --bit) {
+                        int b = (p[i] >> bit) & 1;
+                        n = nodes[n].child[b];
+                        if (n < 0) return -1;
+                        ++depth;
+                        all_ones = all_ones && b;
+                        if (nodes[n].symbol >= 0) {
+                            out.push_back(static_cast<char>(nodes[n].symbol));
+                            n = 0;
+                            depth = 0;
+                            all_ones = true;
+                        }
+                    }
+                }
+                return depth <= 7 && all_ones ? 0 : -1;
+            }
+        };
+
+        // Requests use literal representations without indexing (plus exact
+        // static matches), so the encoder keeps no dynamic table and the
+        // peer's table size setting never has to be honoured.
+        class Encoder {
+        private:
+            static void encode_string(std::string& out, const std::string& s) {
+                encode_integer(out, 0x00, 7, s.size());
+                out += s;
+            }
+        public:
+            void encode(const std::vector<Header>& headers, std::string& out) const {
+                for (const Header& h : headers) {
+                    int name_index = 0;
+                    int full_index = 0;
+                    for (int i = 0; i < 61 && !full_index; ++i) {
+                        if (h.name != static_table[i].name) continue;
+                        if (!name_index) name_index = i + 1;
+                        if (h.value == static_table[i].value) full_index = i + 1;
+                    }
+                    if (full_index) {
+                        encode_integer(out, 0x80, 7, full_index);
+                        continue;
+                    }
+                    encode_integer(out, 0x00, 4, name_index);
+                    if (!name_index) encode_string(out, h.name);
+                    encode_string(out, h.value);
+                }
+            }
+        };
+
+        class Decoder {
+        private:
+            std::deque<Header> dynamic_table;   // newest first
+            size_t table_size = 0;
+            size_t max_table_size = 4096;
+            size_t settings_limit = 4096;
+
+            static size_t entry_size(const Header& h) { return h.name.size() + h.value.size() + 32; }
+            void evict() {
+                while (table_size > max_table_size && !dynamic_table.empty()) {
+                    table_size -= entry_size(dynamic_table.back());
+                    dynamic_table.pop_back();
+                }
+            }
+            void insert(const Header& h) {
+                table_size += entry_size(h);
+                dynamic_table.push_front(h);
+                evict();
+            }
+            int lookup(uint64_t index, Header& out) const {
+                if (index == 0) return -1;
+                if (index <= 61) {
+                    out.name = static_table[index - 1].name;
+                    out.value = static_table[index - 1].value;
+                    return 0;
+                }
+                index -= 62;
+                if (index >= dynamic_table.size()) return -1;
+                out = dynamic_table[index];
+                return 0;
+            }
+            static int decode_string(const uint8_t*& p, const uint8_t* end, std::string& out) {
+                if (p >= end) return -1;
+                bool huffman = *p & 0x80;
+                uint64_t len;
+                if (decode_integer(p, end, 7, len) < 0 || len > static_cast<uint64_t>(end - p)) return -1;
+                out.clear();
+                if (huffman) {
+                    if (HuffmanTree::instance().decode(p, len, out) < 0) return -1;
+                } else {
+                    out.assign(reinterpret_cast<const char*>(p), len);
+                }
+                p += len;
+                return 0;
+            }
+        public:
+            // Upper bound we advertised in SETTINGS_HEADER_TABLE_SIZE.
+            void set_settings_limit(size_t limit) { settings_limit = limit; }
+
+            // Decodes a complete header block. Returns -1 on a compression
+            // error, after which the connection must be torn down.
+            int decode(const uint8_t* p, size_t len, std::vector<Header>& out) {
+                const uint8_t* end = p + len;
+                while (p < end) {
+                    uint8_t b = *p;
+                    uint64_t index;
+                    if (b & 0x80) {
+                        Header h;
+                        if (decode_integer(p, end, 7, index) < 0 || lookup(index, h) < 0) return -1;
+                        out.push_back(std::move(h));
+                    } else if ((b & 0xe0) == 0x20) {
+                        uint64_t size;
+                        if (decode_integer(p, end, 5, size) < 0 || size > settings_limit) return -1;
+                        max_table_size = size;
+                        evict();
+                    } else {
+                        // 01xxxxxx incremental indexing, 0000/0001 without indexing.
+                        bool indexed = (b & 0xc0) == 0x40;
+                        Header h;
+                        if (decode_integer(p, end, indexed ? 6 : 4, index) < 0) return -1;
+                        if (index) {
+                            Header named;
+                            if (lookup(index, named) < 0) return -1;
+                            h.name = std::move(named.name);
+                        } else if (decode_string(p, end, h.name) < 0) {
+                            return -1;
+                        }
+                        if (decode_string(p, end, h.value) < 0) return -1;
+                        if (indexed) insert(h);
+                        out.push_back(std::move(h));
+                    }
+                }
+                return 0;
+            }
+        };
+    }
+}
+
+#endif // FMX_HPACK_HPP
@@ -2,46 +2,92 @@
 #define FMX_HTTP_HPP
 
 #include "tcp.hpp"
+#include "dualstack.hpp"
 #include <netdb.h>
 #include <string>
 
 namespace fmx {
-    template <typename AddrType> class TcpImpl;
-
+    // Connection state shared by every HttpImpl instantiation. There are no
+    // virtual functions: HttpImpl is bound to its transport at compile time.
     class HttpBase {
     protected:
         std::string host;
+        std::string address;
         unsigned short port = 80;
         std::string request;
         std::string response;
-    public:
-        virtual ~HttpBase() = default;
-        virtual int initHttp(const std::string& host) = 0;
-        virtual int connectToServer() = 0;
-        virtual int sendRequest() = 0;
-        virtual int receiveResponse() = 0;
-        virtual const char* getResponse() const = 0;
-        virtual int GET(const std::string& path = "/", const std::string& headers = "") = 0;
-        virtual int POST(const std::string& path, const std::string& body = "", const std::string& headers = "") = 0;
-        virtual int HEAD(const std::string& path = "/", const std::string& headers = "") = 0;
-        virtual int PUT(const std::string& path, const std::string& body = "", const std::string& headers = "") = 0;
-        virtual int DELETE(const std::string& path, const std::string& headers = "") = 0;
-        virtual void setTimeout(unsigned long long ms) = 0;
-        virtual int set_port(unsigned short p) = 0; 
+        HttpBase() = default;
+        ~HttpBase() = default;
+
+        // Resolves host to a numeric address of the transport's family; the
+        // address is applied with the current port when connecting.
+        template <typename TcpType>
+        int resolve_host(const std::string& name) {
+            host = name;
+            if constexpr (TcpType::get_address_family() == AF_UNSPEC) {
+                address = name;
+            } else if constexpr (TcpType::get_address_family() == AF_UNIX) {
+                // Same-host transports are addressed by path/name.
+                host = "localhost";
+                address = name;
+            } else {
+                struct addrinfo hints{}, *res;
+                hints.ai_family = TcpType::get_address_family();
+                hints.ai_socktype = SOCK_STREAM;
+
+                if (getaddrinfo(name.c_str(), nullptr, &hints, &res) != 0) {
+                    return -1; // Error resolving host
+                }
+                char ip[NI_MAXHOST];
+                int ret = getnameinfo(res->ai_addr, res->ai_addrlen, ip, sizeof(ip), nullptr, 0, NI_NUMERICHOST);
+                freeaddrinfo(res);
+                if (ret != 0) return -1;
+                address = ip;
+            }
+            return 0;
+        }
     };
-    template <typename TcpType>
+
+    // Content-coding policy for HttpImpl: bodies are sent and returned as-is.
+    // compress.hpp provides ZlibCoding (gzip/deflate).
+    struct IdentityCoding {
+        static constexpr bool enabled = false;
+    };
+
+    // HTTP/1.1 client over any stream transport exposing initTcp, set_address,
+    // connect_to_server, send_data, recv_some, set_timeout and a static
+    // get_address_family (AF_UNSPEC if the transport resolves names itself).
+    template <typename TcpType, typename Coding = IdentityCoding>
     class HttpImpl : public HttpBase {
     private:
         TcpType tcp;
+        Coding coding;
+
+        // Feeds the response through the coding policy until the server
+        // closes: the head goes to response, the decoded body to on_body.
+        template <typename Sink>
+        int receive_decoded(Sink&& on_body) {
+            response.clear();
+            coding.begin_response();
+            char buffer[16384];
+            int bytes_received = 0;
+            size_t total = 0;
+            while ((bytes_received = tcp.recv_some(buffer, sizeof(buffer))) > 0) {
+                total += bytes_received;
+                if (coding.feed(buffer, bytes_received, response, on_body) < 0) return -1;
+            }
+            if (bytes_received < 0 && total == 0) return -1;
+            return 0;
+        }
     protected:
-        int build_and_send(const std::string& method, const std::string& path, 
+        int build_and_send(const std::string& method, const std::string& path,
                         const std::string& headers, const std::string& body) {
             request = method + " " + path + " HTTP/1.1\r\n";
             request += "Host: " + host + "\r\n";
             request += "User-Agent: FMX-HttpClient/1.0\r\n";
             request += "Accept: */*\r\n";
             request += "Connection: close\r\n";
-            
+
             if (!headers.empty()) {
                 std::string h = headers;
                 size_t pos = 0;
@@ -52,69 +98,88 @@ namespace fmx {
                 request += h;
                 if (h.substr(h.size()-2) != "\r\n") request += "\r\n";
             }
-            
-            if (!body.empty()) {
-                request += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+
+            const std::string* payload = &body;
+            std::string encoded;
+            if constexpr (Coding::enabled) {
+                coding.add_request_headers(request);
+                if (const char* name = coding.encode_body(headers, body, encoded)) {
+                    request += std::string("Content-Encoding: ") + name + "\r\n";
+                    payload = &encoded;
+                }
             }
-            
+
+            if (!payload->empty()) {
+                request += "Content-Length: " + std::to_string(payload->size()) + "\r\n";
+            }
+
             request += "\r\n";
-            if (!body.empty()) request += body;
-            
+            if (!payload->empty()) request += *payload;
+
             return sendRequest();
         }
 
     public:
         HttpImpl() = default;
-        ~HttpImpl() override { tcp.close_connection(); }
-        
-        int initHttp(const std::string& host) override {
-            this->host = host;
-            struct addrinfo hints{}, *res;
-            hints.ai_family = TcpType::get_address_family();
-            hints.ai_socktype = SOCK_STREAM;
-            
-            if (getaddrinfo(host.c_str(), nullptr, &hints, &res) != 0) {
-                return -1; // Error resolving host
-            }
-            
-            port = 80; // Default HTTP port
-            tcp.initTcp();
-            
-            if (tcp.set_address(host.c_str(), port) < 0) {
-                freeaddrinfo(res);
-                return -1; // Error setting address
-            }
-            
-            freeaddrinfo(res);
-            return 0;
+        ~HttpImpl() { tcp.close_connection(); }
+
+        int initHttp(const std::string& host) {
+            if (resolve_host<TcpType>(host) < 0) return -1;
+            return tcp.initTcp();
         }
-        int connectToServer() override {return tcp.connect_to_server();}
-        int sendRequest() override {return tcp.send_data(request.c_str(), request.size());}
-        int receiveResponse() override {
+        int connectToServer() {
+            if (tcp.set_address(address.c_str(), port) < 0) return -1;
+            return tcp.connect_to_server();
+        }
+        int sendRequest() {return tcp.send_data(request);}
+        // Reads until the server closes the connection. Returns the response
+        // size, or -1 if nothing could be read. With a content-coding policy
+        // the body is decoded as it arrives.
+        int receiveResponse() {
+            if constexpr (Coding::enabled) {
+                int ret = receive_decoded([this](const char* data, size_t size) { response.append(data, size); });
+                return ret < 0 ? -1 : static_cast<int>(response.size());
+            }
             response.clear();
             char buffer[4096];
             int bytes_received=0;
-            while ((bytes_received = tcp.receive_data(buffer, sizeof(buffer))) > 0) {
+            while ((bytes_received = tcp.recv_some(buffer, sizeof(buffer))) > 0) {
                 response.append(buffer, bytes_received);
             }
-            return bytes_received;
+            if (bytes_received < 0 && response.empty()) return -1;
+            return static_cast<int>(response.size());
         }
-        const char* getResponse() const override {return response.c_str();}
-        int GET(const std::string& path, const std::string& headers) override 
+        // Hands the decoded body to on_body(data, size) chunk by chunk instead
+        // of buffering it; getResponse() then holds only the head. Returns the
+        // number of body bytes delivered, or -1.
+        template <typename Sink>
+        int receiveResponse(Sink&& on_body) {
+            static_assert(Coding::enabled, "streaming bodies need a content-coding policy such as ZlibCoding");
+            size_t delivered = 0;
+            int ret = receive_decoded([&](const char* data, size_t size) {
+                delivered += size;
+                on_body(data, size);
+            });
+            return ret < 0 ? -1 : static_cast<int>(delivered);
+        }
+        const char* getResponse() const {return response.c_str();}
+        int GET(const std::string& path = "/", const std::string& headers = "")
         {return build_and_send("GET", path, headers, "");}
-        int POST(const std::string& path, const std::string& body, const std::string& headers) override 
+        int POST(const std::string& path, const std::string& body = "", const std::string& headers = "")
         {return build_and_send("POST", path, headers, body);}
-        int HEAD(const std::string& path, const std::string& headers) override 
+        int HEAD(const std::string& path = "/", const std::string& headers = "")
         {return build_and_send("HEAD", path, headers, "");}
-        int PUT(const std::string& path, const std::string& body, const std::string& headers) override 
+        int PUT(const std::string& path, const std::string& body = "", const std::string& headers = "")
         {return build_and_send("PUT", path, headers, body);}
-        int DELETE(const std::string& path, const std::string& headers) override 
+        int DELETE(const std::string& path, const std::string& headers = "")
         {return build_and_send("DELETE", path, headers, "");}
-        void setTimeout(unsigned long long ms) override {tcp.set_timeout(ms);}
-        int set_port(unsigned short p) override {
+        void setTimeout(unsigned long long ms) {tcp.set_timeout(ms);}
+        int set_port(unsigned short p) {
             port = p;
             return 0;
         }
+        TcpType& get_transport() {return tcp;}
+        Coding& get_coding() {return coding;}
     };
 
     class Httpv4 : public HttpImpl<TcpIPv4> {
@@ -127,6 +192,12 @@ namespace fmx {
         Httpv6() = default;
     };
 
+    // Races IPv6 and IPv4 on connect (see TcpDualStack).
+    class HttpDualStack : public HttpImpl<TcpDualStack> {
+    public:
+        HttpDualStack() = default;
+    };
+
 } // namespace fmx
 
-#endif // FMX_HTTP_HPP
\ No newline at end of file
+#endif // FMX_HTTP_HPP
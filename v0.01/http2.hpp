@@ -0,0 +1,518 @@
+#if !defined(FMX_HTTP2_HPP)
+#define FMX_HTTP2_HPP
+
+#include "http.hpp"
+#include "framing.hpp"
+#include "hpack.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace fmx {
+    struct Http2Response {
+        int status = 0;
+        std::vector<hpack::Header> headers;     // response headers and trailers
+        std::string body;
+        bool complete = false;                  // finished, successfully or not
+        uint32_t error_code = 0;                // RST_STREAM/GOAWAY code
+
+        bool ok() const { return complete && status != 0 && error_code == 0; }
+    };
+
+    // HTTP/2 client (RFC 9113) using prior-knowledge cleartext (h2c). Every
+    // request is a stream on one connection: GET/POST/... queue it and return
+    // its stream id at once, receiveResponse(id) waits for that stream only.
+    // Same transport requirements as HttpImpl; TLS/ALPN is not available yet.
+    template <typename TcpType>
+    class Http2Client : public HttpBase {
+    private:
+        enum : uint8_t {
+            DATA = 0x0, HEADERS = 0x1, PRIORITY = 0x2, RST_STREAM = 0x3, SETTINGS = 0x4,
+            PUSH_PROMISE = 0x5, PING = 0x6, GOAWAY = 0x7, WINDOW_UPDATE = 0x8, CONTINUATION = 0x9
+        };
+        enum : uint8_t { END_STREAM = 0x1, ACK = 0x1, END_HEADERS = 0x4, PADDED = 0x8, PRIORITY_FLAG = 0x20 };
+        enum : uint16_t { SETTINGS_ENABLE_PUSH = 0x2, SETTINGS_MAX_CONCURRENT_STREAMS = 0x3,
+                          SETTINGS_INITIAL_WINDOW_SIZE = 0x4, SETTINGS_MAX_FRAME_SIZE = 0x5 };
+        enum : uint32_t { NO_ERROR = 0x0, PROTOCOL_ERROR = 0x1, INTERNAL_ERROR = 0x2, FLOW_CONTROL_ERROR = 0x3,
+                          FRAME_SIZE_ERROR = 0x6, REFUSED_STREAM = 0x7, COMPRESSION_ERROR = 0x9 };
+
+        static constexpr size_t frame_header_size = 9;
+        static constexpr uint32_t local_max_frame = 16384;
+        // Receive window advertised for every stream and for the connection;
+        // credit is returned once half of it has been consumed.
+        static constexpr uint32_t local_window = 1u << 24;
+
+        struct Stream {
+            Http2Response response;
+            std::string body_out;               // request body, sent as windows allow
+            size_t body_sent = 0;
+            int64_t send_window = 0;
+            uint32_t unacked = 0;               // received bytes not yet credited back
+            bool opened = false;
+            bool local_closed = false;
+            bool closed = false;
+        };
+        struct PendingRequest {
+            uint32_t id;
+            std::vector<hpack::Header> headers;
+            std::string body;
+        };
+
+        TcpType tcp;
+        RingBuffer ring;
+        hpack::Encoder encoder;
+        hpack::Decoder decoder;
+        std::map<uint32_t, Stream> streams;
+        std::deque<PendingRequest> queued;      // waiting for a concurrency slot
+        std::string out;                        // frames batched until the next flush
+        std::string header_block;               // HEADERS + CONTINUATION being assembled
+        uint32_t header_stream = 0;             // nonzero while a header block is open
+        bool header_end_stream = false;
+        uint32_t next_stream_id = 1;
+        size_t open_streams = 0;
+        int64_t conn_send_window = 65535;
+        uint32_t conn_unacked = 0;
+        uint32_t peer_initial_window = 65535;
+        uint32_t peer_max_frame = 16384;
+        uint32_t peer_max_streams = 100;
+        bool peer_settings = false;             // server preface received
+        uint32_t goaway_last_id = UINT32_MAX;
+        bool connected = false;
+
+        static uint32_t read_u32(const uint8_t* p) {
+            return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+        }
+        static void put_u32(std::string& s, uint32_t v) {
+            char b[4] = { char(v >> 24), char(v >> 16), char(v >> 8), char(v) };
+            s.append(b, 4);
+        }
+        void put_frame(uint8_t type, uint8_t flags, uint32_t id, const char* payload, size_t len) {
+            char h[frame_header_size] = { char(len >> 16), char(len >> 8), char(len), char(type), char(flags),
+                                          char((id >> 24) & 0x7f), char(id >> 16), char(id >> 8), char(id) };
+            out.append(h, sizeof(h));
+            out.append(payload, len);
+        }
+        void window_update(uint32_t id, uint32_t increment) {
+            std::string p;
+            put_u32(p, increment);
+            put_frame(WINDOW_UPDATE, 0, id, p.data(), p.size());
+        }
+        int flush() {
+            if (out.empty()) return 0;
+            int ret = tcp.send_data(out);
+            out.clear();
+            return ret < 0 ? fail(INTERNAL_ERROR) : 0;
+        }
+
+        // Marks every unfinished stream as failed with code.
+        int fail(uint32_t code) {
+            connected = false;
+            for (auto& entry : streams) {
+                Stream& s = entry.second;
+                if (!s.response.complete) {
+                    s.response.complete = true;
+                    s.response.error_code = code;
+                }
+            }
+            queued.clear();
+            return -1;
+        }
+        int connection_error(uint32_t code) {
+            std::string p;
+            put_u32(p, 0);
+            put_u32(p, code);
+            put_frame(GOAWAY, 0, 0, p.data(), p.size());
+            tcp.send_data(out);
+            out.clear();
+            tcp.close_connection();
+            return fail(code);
+        }
+        void close_if_done(Stream& s) {
+            if (s.opened && !s.closed && s.response.complete && s.local_closed) {
+                s.closed = true;
+                --open_streams;
+            }
+        }
+        void reset_stream(Stream& s, uint32_t code) {
+            if (!s.response.complete) {
+                s.response.complete = true;
+                s.response.error_code = code == NO_ERROR ? REFUSED_STREAM : code;
+            }
+            s.local_closed = true;
+            close_if_done(s);
+        }
+
+        void open_stream(PendingRequest& req) {
+            Stream& s = streams[req.id];
+            std::string block;
+            encoder.encode(req.headers, block);
+            bool end_stream = req.body.empty();
+            size_t offset = 0;
+            uint8_t type = HEADERS;
+            do {
+                size_t chunk = std::min<size_t>(block.size() - offset, peer_max_frame);
+                uint8_t flags = offset + chunk == block.size() ? END_HEADERS : 0;
+                if (type == HEADERS && end_stream) flags |= END_STREAM;
+                put_frame(type, flags, req.id, block.data() + offset, chunk);
+                offset += chunk;
+                type = CONTINUATION;
+            } while (offset < block.size());
+            s.send_window = peer_initial_window;
+            s.body_out = std::move(req.body);
+            s.opened = true;
+            s.local_closed = end_stream;
+            ++open_streams;
+        }
+        void start_queued() {
+            while (!queued.empty() && open_streams < peer_max_streams) {
+                PendingRequest& req = queued.front();
+                if (req.id > goaway_last_id) {
+                    reset_stream(streams[req.id], REFUSED_STREAM);
+                } else {
+                    open_stream(req);
+                }
+                queued.pop_front();
+            }
+        }
+        // Emits DATA for every stream as far as both send windows allow.
+        void send_pending_data() {
+            for (auto& entry : streams) {
+                Stream& s = entry.second;
+                if (!s.opened || s.local_closed) continue;
+                while (conn_send_window > 0 && s.send_window > 0) {
+                    size_t chunk = std::min<int64_t>({ static_cast<int64_t>(s.body_out.size() - s.body_sent),
+                                                       s.send_window, conn_send_window, peer_max_frame });
+                    bool last = s.body_sent + chunk == s.body_out.size();
+                    put_frame(DATA, last ? END_STREAM : 0, entry.first, s.body_out.data() + s.body_sent, chunk);
+                    s.body_sent += chunk;
+                    s.send_window -= chunk;
+                    conn_send_window -= chunk;
+                    if (last) {
+                        s.local_closed = true;
+                        std::string().swap(s.body_out);
+                        close_if_done(s);
+                        break;
+                    }
+                }
+            }
+        }
+
+        // Strips the pad length octet and padding from a PADDED frame.
+        static int strip_padding(uint8_t flags, const uint8_t*& p, uint32_t& len) {
+            if (!(flags & PADDED)) return 0;
+            if (len < 1 || p[0] >= len) return -1;
+            len -= 1 + p[0];
+            ++p;
+            return 0;
+        }
+        int end_headers() {
+            uint32_t id = header_stream;
+            header_stream = 0;
+            // Decoded even for unknown streams to keep the HPACK table in sync.
+            std::vector<hpack::Header> headers;
+            if (decoder.decode(reinterpret_cast<const uint8_t*>(header_block.data()), header_block.size(), headers) < 0)
+                return connection_error(COMPRESSION_ERROR);
+            auto it = streams.find(id);
+            if (it == streams.end() || it->second.response.complete) return 0;
+            Stream& s = it->second;
+            int status = 0;
+            for (const hpack::Header& h : headers) {
+                if (h.name == ":status") status = std::atoi(h.value.c_str());
+            }
+            if (status >= 100 && status < 200) return 0;   // interim response
+            if (status) s.response.status = status;
+            for (hpack::Header& h : headers) {
+                if (h.name[0] != ':') s.response.headers.push_back(std::move(h));
+            }
+            if (header_end_stream) {
+                s.response.complete = true;
+                close_if_done(s);
+            }
+            return 0;
+        }
+        int handle_frame(uint8_t type, uint8_t flags, uint32_t id, const uint8_t* p, uint32_t len) {
+            if (header_stream && (type != CONTINUATION || id != header_stream))
+                return connection_error(PROTOCOL_ERROR);
+            switch (type) {
+            case DATA: {
+                if (id == 0 || strip_padding(flags, p, len) < 0) return connection_error(PROTOCOL_ERROR);
+                uint32_t frame_len = len + (flags & PADDED ? static_cast<uint32_t>(p[-1]) + 1 : 0);
+                conn_unacked += frame_len;
+                auto it = streams.find(id);
+                if (it != streams.end() && !it->second.response.complete) {
+                    Stream& s = it->second;
+                    s.response.body.append(reinterpret_cast<const char*>(p), len);
+                    if (flags & END_STREAM) {
+                        s.response.complete = true;
+                        close_if_done(s);
+                    } else if ((s.unacked += frame_len) >= local_window / 2) {
+                        window_update(id, s.unacked);
+                        s.unacked = 0;
+                    }
+                }
+                if (conn_unacked >= local_window / 2) {
+                    window_update(0, conn_unacked);
+                    conn_unacked = 0;
+                }
+                return 0;
+            }
+            case HEADERS: {
+                if (id == 0 || strip_padding(flags, p, len) < 0) return connection_error(PROTOCOL_ERROR);
+                if (flags & PRIORITY_FLAG) {
+                    if (len < 5) return connection_error(PROTOCOL_ERROR);
+                    p += 5;
+                    len -= 5;
+                }
+                header_block.assign(reinterpret_cast<const char*>(p), len);
+                header_stream = id;
+                header_end_stream = flags & END_STREAM;
+                return flags & END_HEADERS ? end_headers() : 0;
+            }
+            case CONTINUATION:
+                if (!header_stream) return connection_error(PROTOCOL_ERROR);
+                header_block.append(reinterpret_cast<const char*>(p), len);
+                return flags & END_HEADERS ? end_headers() : 0;
+            case RST_STREAM: {
+                if (id == 0) return connection_error(PROTOCOL_ERROR);
+                if (len != 4) return connection_error(FRAME_SIZE_ERROR);
+                auto it = streams.find(id);
+                if (it != streams.end()) reset_stream(it->second, read_u32(p));
+                return 0;
+            }
+            case SETTINGS: {
+                if (id != 0) return connection_error(PROTOCOL_ERROR);
+                if (flags & ACK) return 0;
+                if (len % 6) return connection_error(FRAME_SIZE_ERROR);
+                peer_settings = true;
+                for (uint32_t i = 0; i < len; i += 6) {
+                    uint16_t key = (p[i] << 8) | p[i + 1];
+                    uint32_t value = read_u32(p + i + 2);
+                    if (key == SETTINGS_MAX_CONCURRENT_STREAMS) {
+                        peer_max_streams = value;
+                    } else if (key == SETTINGS_INITIAL_WINDOW_SIZE) {
+                        if (value > 0x7fffffff) return connection_error(FLOW_CONTROL_ERROR);
+                        int64_t delta = static_cast<int64_t>(value) - peer_initial_window;
+                        for (auto& entry : streams) {
+                            if (entry.second.opened) entry.second.send_window += delta;
+                        }
+                        peer_initial_window = value;
+                    } else if (key == SETTINGS_MAX_FRAME_SIZE) {
+                        if (value < 16384 || value > 16777215) return connection_error(PROTOCOL_ERROR);
+                        peer_max_frame = value;
+                    }
+                }
+                put_frame(SETTINGS, ACK, 0, nullptr, 0);
+                return 0;
+            }
+            case PUSH_PROMISE:
+                // Disabled by our SETTINGS_ENABLE_PUSH = 0.
+                return connection_error(PROTOCOL_ERROR);
+            case PING:
+                if (id != 0) return connection_error(PROTOCOL_ERROR);
+                if (len != 8) return connection_error(FRAME_SIZE_ERROR);
+                if (!(flags & ACK)) put_frame(PING, ACK, 0, reinterpret_cast<const char*>(p), len);
+                return 0;
+            case GOAWAY: {
+                if (id != 0) return connection_error(PROTOCOL_ERROR);
+                if (len < 8) return connection_error(FRAME_SIZE_ERROR);
+                // Streams above last_id were never processed and may be retried.
+                goaway_last_id = read_u32(p) & 0x7fffffff;
+                for (auto& entry : streams) {
+                    if (entry.first > goaway_last_id && entry.second.opened) reset_stream(entry.second, REFUSED_STREAM);
+                }
+                return 0;
+            }
+            case WINDOW_UPDATE: {
+                if (len != 4) return connection_error(FRAME_SIZE_ERROR);
+                uint32_t increment = read_u32(p) & 0x7fffffff;
+                if (id == 0) {
+                    if (increment == 0) return connection_error(PROTOCOL_ERROR);
+                    conn_send_window += increment;
+                } else {
+                    auto it = streams.find(id);
+                    if (it != streams.end()) it->second.send_window += increment;
+                }
+                return 0;
+            }
+            default:
+                // PRIORITY and unknown frame types are ignored.
+                return 0;
+            }
+        }
+        // One receive, then every complete frame in the buffer is processed.
+        int read_frames() {
+            if (ring.get_capacity() == 0 && ring.init(64 * 1024) < 0) return -1;
+            char* dst = ring.write_ptr();
+            int n = tcp.recv_some(dst, ring.writable());
+            if (n == 0) return fail(INTERNAL_ERROR);
+            if (n < 0) return -1;
+            ring.commit(n);
+            while (ring.readable() >= frame_header_size) {
+                const uint8_t* h = reinterpret_cast<const uint8_t*>(ring.read_ptr());
+                uint32_t len = (uint32_t(h[0]) << 16) | (uint32_t(h[1]) << 8) | h[2];
+                if (len > local_max_frame) return connection_error(FRAME_SIZE_ERROR);
+                if (ring.readable() < frame_header_size + len) break;
+                if (handle_frame(h[3], h[4], read_u32(h + 5) & 0x7fffffff, h + frame_header_size, len) < 0)
+                    return -1;
+                ring.consume(frame_header_size + len);
+            }
+            return 0;
+        }
+        // Sends whatever is ready, then waits for the next batch of frames.
+        int pump() {
+            start_queued();
+            send_pending_data();
+            if (flush() < 0) return -1;
+            return read_frames();
+        }
+
+        int submit(const std::string& method, const std::string& path,
+                   const std::string& headers, const std::string& body) {
+            if (!connected || next_stream_id > 0x7fffffff || goaway_last_id != UINT32_MAX) return -1;
+            PendingRequest req;
+            req.id = next_stream_id;
+            next_stream_id += 2;
+            std::string authority = port == 80 ? host : host + ":" + std::to_string(port);
+            req.headers = { { ":method", method }, { ":scheme", "http" }, { ":authority", authority },
+                            { ":path", path }, { "user-agent", "FMX-HttpClient/1.0" }, { "accept", "*/*" } };
+            size_t pos = 0;
+            while (pos < headers.size()) {
+                size_t eol = headers.find('\n', pos);
+                if (eol == std::string::npos) eol = headers.size();
+                std::string line = headers.substr(pos, eol - pos);
+                pos = eol + 1;
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                size_t colon = line.find(':');
+                if (colon == std::string::npos || colon == 0) continue;
+                hpack::Header h;
+                h.name = line.substr(0, colon);
+                std::transform(h.name.begin(), h.name.end(), h.name.begin(), ::tolower);
+                size_t value = line.find_first_not_of(" \t", colon + 1);
+                h.value = value == std::string::npos ? "" : line.substr(value);
+                // Connection-specific fields are not allowed in HTTP/2.
+                if (h.name == "connection" || h.name == "keep-alive" || h.name == "transfer-encoding" ||
+                    h.name == "upgrade" || h.name == "host")
+                    continue;
+                req.headers.push_back(std::move(h));
+            }
+            if (!body.empty()) req.headers.push_back({ "content-length", std::to_string(body.size()) });
+            req.body = body;
+            streams[req.id];
+            queued.push_back(std::move(req));
+            start_queued();
+            send_pending_data();
+            if (flush() < 0) return -1;
+            return static_cast<int>(next_stream_id - 2);
+        }
+
+    public:
+        Http2Client() = default;
+        ~Http2Client() { tcp.close_connection(); }
+
+        int initHttp(const std::string& host) {
+            if (resolve_host<TcpType>(host) < 0) return -1;
+            return tcp.initTcp();
+        }
+        // Connects, sends the connection preface and waits for the server's
+        // SETTINGS so its concurrency limit is known before the first request.
+        int connectToServer() {
+            if (tcp.set_address(address.c_str(), port) < 0) return -1;
+            if (tcp.connect_to_server() < 0) return -1;
+            out.assign("PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n");
+            std::string settings;
+            settings.append("\x00\x02", 2);
+            put_u32(settings, 0);
+            settings.append("\x00\x04", 2);
+            put_u32(settings, local_window);
+            put_frame(SETTINGS, 0, 0, settings.data(), settings.size());
+            window_update(0, local_window - 65535);
+            connected = true;
+            if (flush() < 0) return -1;
+            while (!peer_settings) {
+                if (read_frames() < 0) return -1;
+            }
+            return flush();
+        }
+
+        // Each returns the new stream id, or -1. Requests beyond the server's
+        // concurrency limit are queued and sent as earlier streams finish.
+        int GET(const std::string& path = "/", const std::string& headers = "")
+        {return submit("GET", path, headers, "");}
+        int POST(const std::string& path, const std::string& body = "", const std::string& headers = "")
+        {return submit("POST", path, headers, body);}
+        int HEAD(const std::string& path = "/", const std::string& headers = "")
+        {return submit("HEAD", path, headers, "");}
+        int PUT(const std::string& path, const std::string& body = "", const std::string& headers = "")
+        {return submit("PUT", path, headers, body);}
+        int DELETE(const std::string& path, const std::string& headers = "")
+        {return submit("DELETE", path, headers, "");}
+
+        // Waits for one stream; its body is then also available through
+        // getResponse(). Returns the body size, or -1 if the stream failed.
+        int receiveResponse(int id) {
+            auto it = streams.find(static_cast<uint32_t>(id));
+            if (it == streams.end()) return -1;
+            Stream& s = it->second;
+            while (!s.response.complete) {
+                if (pump() < 0) return -1;
+            }
+            if (!s.response.ok()) return -1;
+            response = s.response.body;
+            return static_cast<int>(response.size());
+        }
+        // Waits for every outstanding stream. Returns -1 if any failed.
+        int receiveResponse() {
+            int ret = 0;
+            for (auto& entry : streams) {
+                while (!entry.second.response.complete) {
+                    if (pump() < 0) return -1;
+                }
+                if (!entry.second.response.ok()) ret = -1;
+            }
+            return ret;
+        }
+        const char* getResponse() const {return response.c_str();}
+        // Full result of a stream, or nullptr if unknown. Finished streams are
+        // kept until release() is called.
+        const Http2Response* get_stream_response(int id) const {
+            auto it = streams.find(static_cast<uint32_t>(id));
+            return it == streams.end() ? nullptr : &it->second.response;
+        }
+        void release(int id) {
+            auto it = streams.find(static_cast<uint32_t>(id));
+            if (it == streams.end() || !it->second.response.complete) return;
+            // A stream still sending its body stays until it is closed.
+            if (it->second.closed || !it->second.opened || !connected) streams.erase(it);
+        }
+        size_t active_streams() const { return open_streams + queued.size(); }
+
+        void setTimeout(unsigned long long ms) {tcp.set_timeout(ms);}
+        int set_port(unsigned short p) {
+            port = p;
+            return 0;
+        }
+        TcpType& get_transport() {return tcp;}
+    };
+
+    class Http2v4 : public Http2Client<TcpIPv4> {
+    public:
+        Http2v4() = default;
+    };
+
+    class Http2v6 : public Http2Client<TcpIPv6> {
+    public:
+        Http2v6() = default;
+    };
+
+    class Http2DualStack : public Http2Client<TcpDualStack> {
+    public:
+        Http2DualStack() = default;
+    };
+}
+
+#endif // FMX_HTTP2_HPP
@@ -0,0 +1,290 @@
+#if !defined(FMX_POOL_HPP)
+#define FMX_POOL_HPP
+
+#include "tcp.hpp"
+#include <sys/socket.h>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace fmx {
+    struct TcpPoolOptions {
+        size_t min_size = 0;                        // connections kept open (and pre-warmed)
+        size_t max_size = 8;                        // upper bound of open connections
+        unsigned long long idle_timeout_ms = 60000; // idle connections above min_size are closed after this
+        unsigned long long connect_timeout_ms = 0;  // passed to set_timeout before connecting
+        unsigned long long acquire_timeout_ms = 0;  // 0 waits forever when the pool is exhausted
+    };
+
+    struct TcpPoolStats {
+        uint64_t acquired = 0;
+        uint64_t reused = 0;
+        uint64_t waited = 0;            // acquires that had to block on a full pool
+        uint64_t wait_time_us = 0;
+        uint64_t max_wait_us = 0;
+        uint64_t created = 0;
+        uint64_t connect_failures = 0;
+        uint64_t closed_dead = 0;       // peer closed / unread data found at hand-out
+        uint64_t closed_idle = 0;
+        uint64_t closed_broken = 0;     // returned by the caller as unusable
+    };
+
+    // Thread-safe pool of established connections to one endpoint. Leases
+    // may outlive the pool: one released after the pool is gone just closes
+    // its connection.
+    template <typename TcpType>
+    class TcpPool {
+    private:
+        using clock = std::chrono::steady_clock;
+        struct IdleConn {
+            std::unique_ptr<TcpType> conn;
+            clock::time_point since;
+        };
+
+        // A pooled connection must have nothing to read: EOF means the peer
+        // closed it, and stray bytes mean the previous user left it out of sync.
+        static bool is_alive(const TcpType& conn) {
+            char c;
+            ssize_t ret = recv(conn.get_fd(), &c, 1, MSG_PEEK | MSG_DONTWAIT);
+            return ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+        }
+
+        // Everything a lease touches on release, shared with the leases
+        // through weak_ptr so it lives exactly as long as the pool.
+        struct State {
+            TcpPoolOptions options;
+            std::mutex mutex;
+            std::condition_variable available;
+            std::deque<IdleConn> idle;
+            size_t open_count = 0;
+            TcpPoolStats stats;
+
+            explicit State(const TcpPoolOptions& options) : options(options) {}
+
+            // Caller holds the lock. Moves expired idle connections into doomed so
+            // they are closed after the lock is released.
+            void collect_idle(std::deque<IdleConn>& doomed) {
+                auto deadline = clock::now() - std::chrono::milliseconds(options.idle_timeout_ms);
+                while (!idle.empty() && open_count > options.min_size && idle.front().since < deadline) {
+                    doomed.push_back(std::move(idle.front()));
+                    idle.pop_front();
+                    --open_count;
+                    ++stats.closed_idle;
+                }
+            }
+            void give_back(std::unique_ptr<TcpType> conn, bool broken) {
+                std::deque<IdleConn> doomed;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (broken || !is_alive(*conn)) {
+                        --open_count;
+                        ++(broken ? stats.closed_broken : stats.closed_dead);
+                        doomed.push_back({ std::move(conn), clock::now() });
+                    } else {
+                        idle.push_back({ std::move(conn), clock::now() });
+                    }
+                    collect_idle(doomed);
+                }
+                available.notify_one();
+            }
+        };
+
+        std::string ip;
+        int port;
+        std::shared_ptr<State> state;
+
+        std::unique_ptr<TcpType> open_connection() {
+            auto conn = std::make_unique<TcpType>();
+            conn->set_timeout(state->options.connect_timeout_ms);
+            if (conn->initTcp() < 0 || conn->set_address(ip.c_str(), port) < 0 ||
+                conn->connect_to_server() < 0) {
+                return nullptr;
+            }
+            conn->set_timeout(0);
+            return conn;
+        }
+    public:
+        // Move-only handle to a leased connection; returns it to the pool on
+        // destruction. Call mark_broken() after an I/O error so it is dropped.
+        class Lease {
+        private:
+            std::weak_ptr<State> pool;
+            std::unique_ptr<TcpType> conn;
+            bool broken = false;
+            friend class TcpPool;
+            Lease(std::weak_ptr<State> pool, std::unique_ptr<TcpType> conn)
+                : pool(std::move(pool)), conn(std::move(conn)) {}
+        public:
+            Lease() = default;
+            Lease(Lease&& other) noexcept
+                : pool(std::move(other.pool)), conn(std::move(other.conn)), broken(other.broken) {}
+            Lease& operator=(Lease&& other) noexcept {
+                if (this != &other) {
+                    release();
+                    pool = std::move(other.pool);
+                    conn = std::move(other.conn);
+                    broken = other.broken;
+                }
+                return *this;
+            }
+            ~Lease() { release(); }
+            void release() {
+                if (conn) {
+                    if (auto state = pool.lock()) state->give_back(std::move(conn), broken);
+                    conn.reset();
+                }
+                pool.reset();
+                broken = false;
+            }
+            void mark_broken() { broken = true; }
+            explicit operator bool() const { return conn != nullptr; }
+            TcpType* operator->() const { return conn.get(); }
+            TcpType& operator*() const { return *conn; }
+        };
+
+        TcpPool(const std::string& ip, int port, const TcpPoolOptions& options = {})
+            : ip(ip), port(port), state(std::make_shared<State>(options)) {}
+        ~TcpPool() = default;
+        TcpPool(const TcpPool&) = delete;
+        TcpPool& operator=(const TcpPool&) = delete;
+
+        // Opens connections until min_size are available. Returns how many
+        // connections are open afterwards, or -1 if any connect failed.
+        int warm_up() {
+            State& s = *state;
+            for (;;) {
+                {
+                    std::lock_guard<std::mutex> lock(s.mutex);
+                    if (s.open_count >= s.options.min_size || s.open_count >= s.options.max_size)
+                        return static_cast<int>(s.open_count);
+                    ++s.open_count;
+                }
+                auto conn = open_connection();
+                std::lock_guard<std::mutex> lock(s.mutex);
+                if (!conn) {
+                    --s.open_count;
+                    ++s.stats.connect_failures;
+                    return -1;
+                }
+                ++s.stats.created;
+                s.idle.push_back({ std::move(conn), clock::now() });
+            }
+        }
+
+        // Hands out an idle connection (most recently used first), opens a new
+        // one below max_size, or waits for a release. Returns an empty lease
+        // on connect failure or acquire timeout.
+        Lease acquire() {
+            State& s = *state;
+            std::deque<IdleConn> doomed;
+            std::unique_lock<std::mutex> lock(s.mutex);
+            auto deadline = clock::now() + std::chrono::milliseconds(s.options.acquire_timeout_ms);
+            bool waited = false;
+            uint64_t waited_us = 0;
+            for (;;) {
+                while (!s.idle.empty()) {
+                    IdleConn entry = std::move(s.idle.back());
+                    s.idle.pop_back();
+                    if (is_alive(*entry.conn)) {
+                        ++s.stats.acquired;
+                        ++s.stats.reused;
+                        s.collect_idle(doomed);
+                        lock.unlock();
+                        return Lease(state, std::move(entry.conn));
+                    }
+                    --s.open_count;
+                    ++s.stats.closed_dead;
+                    doomed.push_back(std::move(entry));
+                }
+                if (s.open_count < s.options.max_size) break;
+                if (!waited) {
+                    waited = true;
+                    ++s.stats.waited;
+                }
+                // The deadline stays fixed across wakeups; wait_start only
+                // feeds the wait statistics.
+                auto wait_start = clock::now();
+                bool timed_out = false;
+                if (s.options.acquire_timeout_ms == 0) {
+                    s.available.wait(lock);
+                } else {
+                    timed_out = s.available.wait_until(lock, deadline) == std::cv_status::timeout ||
+                                clock::now() >= deadline;
+                }
+                uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - wait_start).count();
+                s.stats.wait_time_us += us;
+                waited_us += us;
+                if (waited_us > s.stats.max_wait_us) s.stats.max_wait_us = waited_us;
+                if (timed_out) return Lease();
+            }
+            ++s.open_count;
+            lock.unlock();
+            doomed.clear();
+            auto conn = open_connection();
+            lock.lock();
+            if (!conn) {
+                --s.open_count;
+                ++s.stats.connect_failures;
+                lock.unlock();
+                s.available.notify_one();
+                return Lease();
+            }
+            ++s.stats.created;
+            ++s.stats.acquired;
+            return Lease(state, std::move(conn));
+        }
+
+        // Closes idle connections that exceeded idle_timeout_ms (down to min_size).
+        void evict_idle() {
+            std::deque<IdleConn> doomed;
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->collect_idle(doomed);
+        }
+
+        TcpPoolStats get_stats() {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            return state->stats;
+        }
+        size_t open_connections() {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            return state->open_count;
+        }
+        size_t idle_connections() {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            return state->idle.size();
+        }
+    };
+
+    // One TcpPool per "ip:port" endpoint, created on first use.
+    template <typename TcpType>
+    class TcpPoolMap {
+    private:
+        TcpPoolOptions options;
+        std::mutex mutex;
+        std::map<std::string, std::unique_ptr<TcpPool<TcpType>>> pools;
+    public:
+        explicit TcpPoolMap(const TcpPoolOptions& options = {}) : options(options) {}
+
+        TcpPool<TcpType>& get_pool(const std::string& ip, int port) {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto& pool = pools[ip + ":" + std::to_string(port)];
+            if (!pool) pool = std::make_unique<TcpPool<TcpType>>(ip, port, options);
+            return *pool;
+        }
+        typename TcpPool<TcpType>::Lease acquire(const std::string& ip, int port) {
+            return get_pool(ip, port).acquire();
+        }
+        void evict_idle() {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto& entry : pools) entry.second->evict_idle();
+        }
+    };
+}
+
+#endif // FMX_POOL_HPP
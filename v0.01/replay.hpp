@@ -0,0 +1,433 @@
+#if !defined(FMX_REPLAY_HPP)
+#define FMX_REPLAY_HPP
+
+#include "trace.hpp"
+#include "tcp.hpp"
+#include "udp.hpp"
+#include "http.hpp"
+#include <strings.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace fmx {
+    // Log-linear histogram: 16 sub-buckets per power of two (about 6%
+    // resolution), exact below 16. Values are nanoseconds by convention.
+    class LatencyHistogram {
+    private:
+        static constexpr int sub_bits = 4;
+        std::array<uint64_t, 64 << sub_bits> counts{};
+        uint64_t total = 0;
+        uint64_t sum = 0;
+        uint64_t min_value = UINT64_MAX;
+        uint64_t max_value = 0;
+
+        static int index_of(uint64_t v) {
+            if (v < (1u << sub_bits)) return static_cast<int>(v);
+            int msb = 63 - __builtin_clzll(v);
+            int sub = static_cast<int>((v >> (msb - sub_bits)) & ((1u << sub_bits) - 1));
+            return ((msb - sub_bits + 1) << sub_bits) + sub;
+        }
+        static uint64_t lower_edge(int index) {
+            if (index < (1 << sub_bits)) return index;
+            int msb = (index >> sub_bits) + sub_bits - 1;
+            uint64_t sub = index & ((1u << sub_bits) - 1);
+            return (uint64_t(1) << msb) | (sub << (msb - sub_bits));
+        }
+    public:
+        void record(uint64_t value) {
+            ++counts[index_of(value)];
+            ++total;
+            sum += value;
+            min_value = std::min(min_value, value);
+            max_value = std::max(max_value, value);
+        }
+        void merge(const LatencyHistogram& other) {
+            for (size_t i = 0; i < counts.size(); ++i) counts[i] += other.counts[i];
+            total += other.total;
+            sum += other.sum;
+            min_value = std::min(min_value, other.min_value);
+            max_value = std::max(max_value, other.max_value);
+        }
+        uint64_t count() const { return total; }
+        uint64_t min() const { return total ? min_value : 0; }
+        uint64_t max() const { return max_value; }
+        uint64_t mean() const { return total ? sum / total : 0; }
+        // Upper edge of the bucket holding the p-th percentile (0-100).
+        uint64_t percentile(double p) const {
+            if (total == 0) return 0;
+            uint64_t rank = static_cast<uint64_t>(p / 100.0 * total + 0.5);
+            rank = std::clamp<uint64_t>(rank, 1, total);
+            uint64_t seen = 0;
+            for (size_t i = 0; i < counts.size(); ++i) {
+                seen += counts[i];
+                if (seen >= rank) return std::min(lower_edge(static_cast<int>(i) + 1) - 1, max_value);
+            }
+            return max_value;
+        }
+        // Calls fn(lower, upper, count) for every non-empty bucket.
+        template <typename Fn>
+        void for_each_bucket(Fn&& fn) const {
+            for (size_t i = 0; i < counts.size(); ++i) {
+                if (counts[i]) fn(lower_edge(static_cast<int>(i)), lower_edge(static_cast<int>(i) + 1) - 1, counts[i]);
+            }
+        }
+    };
+
+    struct ReplayOptions {
+        std::string host = "127.0.0.1";
+        unsigned short port = 0;
+        std::map<TraceProtocol, unsigned short> ports;  // per-protocol overrides of port
+        double speed = 1.0;                 // 2.0 replays twice as fast; 0 disables pacing
+        unsigned threads = 16;              // connections replayed concurrently
+        unsigned long long timeout_ms = 2000;
+    };
+
+    struct ReplayReport {
+        LatencyHistogram latency;           // first send to last expected reply byte
+        uint64_t connections = 0;
+        uint64_t exchanges = 0;
+        uint64_t messages_sent = 0;
+        uint64_t bytes_sent = 0;
+        uint64_t bytes_received = 0;
+        uint64_t errors = 0;
+        uint64_t skipped = 0;               // connections with no client for their protocol
+        uint64_t max_lag_ns = 0;            // worst delay behind the scaled schedule
+        uint64_t elapsed_ns = 0;
+
+        void merge(const ReplayReport& other) {
+            latency.merge(other.latency);
+            connections += other.connections;
+            exchanges += other.exchanges;
+            messages_sent += other.messages_sent;
+            bytes_sent += other.bytes_sent;
+            bytes_received += other.bytes_received;
+            errors += other.errors;
+            skipped += other.skipped;
+            max_lag_ns = std::max(max_lag_ns, other.max_lag_ns);
+        }
+    };
+
+    // Replays a trace against a live server. Each trace connection becomes a
+    // client of the matching type, driven from its own worker thread; sends
+    // follow the recorded timing divided by speed and each run of sends is
+    // timed until the recorded amount of reply data (or number of datagrams
+    // and messages) has arrived. SCTP needs sctp.hpp, so its client type is
+    // opt-in: TraceReplayer<TcpIPv4, UdpIPv4, Httpv4, SctpIPv4>.
+    template <typename TcpClient = TcpIPv4, typename UdpClient = UdpIPv4,
+              typename HttpClient = Httpv4, typename SctpClient = void>
+    class TraceReplayer {
+    private:
+        using clock = std::chrono::steady_clock;
+
+        struct Message {
+            std::string_view captured;
+            uint32_t length;
+        };
+        // A run of sends and the replies recorded after it.
+        struct Exchange {
+            uint64_t time_ns = 0;
+            std::vector<Message> sends;
+            uint64_t expect_bytes = 0;
+            uint32_t expect_messages = 0;
+        };
+        struct Connection {
+            uint32_t id = 0;
+            TraceProtocol protocol = TraceProtocol::Tcp;
+            uint64_t start_ns = 0;
+            std::vector<Exchange> exchanges;
+        };
+
+        std::vector<Connection> connections;
+        uint64_t first_ns = 0;
+
+        static unsigned short port_for(TraceProtocol protocol, const ReplayOptions& options) {
+            auto it = options.ports.find(protocol);
+            return it == options.ports.end() ? options.port : it->second;
+        }
+
+        // Payloads cut by the recorder's limit are padded back to full size.
+        static std::string payload_of(const Message& m) {
+            std::string s(m.captured);
+            s.resize(m.length, '\0');
+            return s;
+        }
+        static uint64_t since_ns(clock::time_point t) {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t).count();
+        }
+        void wait_for_slot(uint64_t time_ns, clock::time_point epoch, const ReplayOptions& options,
+                           ReplayReport& report) const {
+            if (options.speed <= 0) return;
+            auto due = epoch + std::chrono::nanoseconds(
+                static_cast<uint64_t>((time_ns - first_ns) / options.speed));
+            auto now = clock::now();
+            if (now < due) {
+                std::this_thread::sleep_until(due);
+            } else {
+                uint64_t lag = std::chrono::duration_cast<std::chrono::nanoseconds>(now - due).count();
+                report.max_lag_ns = std::max(report.max_lag_ns, lag);
+            }
+        }
+
+        template <typename Client>
+        void replay_stream(const Connection& c, clock::time_point epoch, const ReplayOptions& options,
+                           ReplayReport& report) const {
+            Client client;
+            client.set_timeout(options.timeout_ms);
+            wait_for_slot(c.start_ns, epoch, options, report);
+            if (client.initTcp() < 0 || client.set_address(options.host.c_str(), port_for(c.protocol, options)) < 0 ||
+                client.connect_to_server() < 0) {
+                ++report.errors;
+                return;
+            }
+            for (const Exchange& e : c.exchanges) {
+                std::vector<std::string> payloads;
+                for (const Message& m : e.sends) payloads.push_back(payload_of(m));
+                wait_for_slot(e.time_ns, epoch, options, report);
+                auto start = clock::now();
+                for (const std::string& p : payloads) {
+                    if (client.send_data(p) < 0) {
+                        ++report.errors;
+                        return;
+                    }
+                    ++report.messages_sent;
+                    report.bytes_sent += p.size();
+                }
+                if (e.expect_bytes == 0) continue;
+                std::string reply;
+                int n = client.recv_data(reply, e.expect_bytes);
+                report.bytes_received += std::max(n, 0);
+                if (n < 0 || static_cast<uint64_t>(n) < e.expect_bytes) {
+                    ++report.errors;
+                    return;
+                }
+                report.latency.record(since_ns(start));
+                ++report.exchanges;
+            }
+        }
+
+        // UDP and SCTP: message boundaries are kept; a lost reply counts as
+        // an error but the connection carries on.
+        template <typename Client>
+        void replay_messages(const Connection& c, clock::time_point epoch, const ReplayOptions& options,
+                             ReplayReport& report) const {
+            Client client;
+            client.set_timeout(options.timeout_ms);
+            wait_for_slot(c.start_ns, epoch, options, report);
+            int ret;
+            if constexpr (std::is_same_v<Client, UdpClient>) {
+                ret = client.initUdp();
+                if (ret == 0) ret = client.set_address(options.host.c_str(), port_for(c.protocol, options));
+            } else {
+                ret = client.initSctp();
+                if (ret == 0) ret = client.set_address(options.host.c_str(), port_for(c.protocol, options));
+                if (ret == 0) ret = client.connect_to_server();
+            }
+            if (ret < 0) {
+                ++report.errors;
+                return;
+            }
+            for (const Exchange& e : c.exchanges) {
+                std::vector<std::string> payloads;
+                for (const Message& m : e.sends) payloads.push_back(payload_of(m));
+                wait_for_slot(e.time_ns, epoch, options, report);
+                auto start = clock::now();
+                bool sent = true;
+                for (const std::string& p : payloads) {
+                    if (client.send_data(p, client.get_server_addr(), client.get_addr_len()) < 0) {
+                        sent = false;
+                        break;
+                    }
+                    ++report.messages_sent;
+                    report.bytes_sent += p.size();
+                }
+                if (!sent) {
+                    ++report.errors;
+                    continue;
+                }
+                if (e.expect_messages == 0) continue;
+                uint32_t received = 0;
+                std::string reply;
+                while (received < e.expect_messages) {
+                    int n = client.recv_data(reply, nullptr, nullptr);
+                    if (n < 0) break;
+                    report.bytes_received += n;
+                    ++received;
+                }
+                if (received < e.expect_messages) {
+                    ++report.errors;
+                    continue;
+                }
+                report.latency.record(since_ns(start));
+                ++report.exchanges;
+            }
+        }
+
+        // Splits a recorded HTTP/1.1 request into what HttpImpl takes,
+        // dropping the fields HttpImpl generates itself.
+        static bool parse_request(const std::string& raw, std::string& method, std::string& path,
+                                  std::string& headers, std::string& body) {
+            size_t line_end = raw.find("\r\n");
+            size_t head_end = raw.find("\r\n\r\n");
+            size_t sp1 = raw.find(' ');
+            size_t sp2 = sp1 == std::string::npos ? sp1 : raw.find(' ', sp1 + 1);
+            if (head_end == std::string::npos || sp2 == std::string::npos || sp2 > line_end) return false;
+            method = raw.substr(0, sp1);
+            path = raw.substr(sp1 + 1, sp2 - sp1 - 1);
+            headers.clear();
+            for (size_t pos = line_end + 2, eol; pos < head_end; pos = eol + 2) {
+                eol = raw.find("\r\n", pos);
+                const char* field = raw.c_str() + pos;
+                if (strncasecmp(field, "host:", 5) == 0 || strncasecmp(field, "user-agent:", 11) == 0 ||
+                    strncasecmp(field, "accept:", 7) == 0 || strncasecmp(field, "connection:", 11) == 0 ||
+                    strncasecmp(field, "content-length:", 15) == 0)
+                    continue;
+                headers.append(raw, pos, eol + 2 - pos);
+            }
+            body = raw.substr(head_end + 4);
+            return true;
+        }
+
+        // One HttpClient per request, as HttpImpl closes after each response;
+        // latency includes the connect.
+        void replay_http(const Connection& c, clock::time_point epoch, const ReplayOptions& options,
+                         ReplayReport& report) const {
+            for (const Exchange& e : c.exchanges) {
+                std::string raw;
+                for (const Message& m : e.sends) raw += payload_of(m);
+                std::string method, path, headers, body;
+                if (raw.empty()) continue;
+                if (!parse_request(raw, method, path, headers, body)) {
+                    ++report.errors;
+                    continue;
+                }
+                HttpClient http;
+                http.setTimeout(options.timeout_ms);
+                if (http.initHttp(options.host) < 0) {
+                    ++report.errors;
+                    return;
+                }
+                http.set_port(port_for(c.protocol, options));
+                wait_for_slot(e.time_ns, epoch, options, report);
+                auto start = clock::now();
+                int sent = -1;
+                if (http.connectToServer() == 0) {
+                    if (method == "GET") sent = http.GET(path, headers);
+                    else if (method == "POST") sent = http.POST(path, body, headers);
+                    else if (method == "HEAD") sent = http.HEAD(path, headers);
+                    else if (method == "PUT") sent = http.PUT(path, body, headers);
+                    else if (method == "DELETE") sent = http.DELETE(path, headers);
+                }
+                if (sent < 0) {
+                    ++report.errors;
+                    continue;
+                }
+                ++report.messages_sent;
+                report.bytes_sent += sent;
+                int n = http.receiveResponse();
+                if (n <= 0) {
+                    ++report.errors;
+                    continue;
+                }
+                report.latency.record(since_ns(start));
+                report.bytes_received += n;
+                ++report.exchanges;
+            }
+        }
+
+        void replay_connection(const Connection& c, clock::time_point epoch, const ReplayOptions& options,
+                               ReplayReport& report) const {
+            ++report.connections;
+            switch (c.protocol) {
+            case TraceProtocol::Tcp:
+                replay_stream<TcpClient>(c, epoch, options, report);
+                break;
+            case TraceProtocol::Udp:
+                replay_messages<UdpClient>(c, epoch, options, report);
+                break;
+            case TraceProtocol::Sctp:
+                if constexpr (!std::is_void_v<SctpClient>) {
+                    replay_messages<SctpClient>(c, epoch, options, report);
+                } else {
+                    ++report.skipped;
+                }
+                break;
+            case TraceProtocol::Http:
+                replay_http(c, epoch, options, report);
+                break;
+            }
+        }
+    public:
+        // Groups the records by connection. The reader must outlive the
+        // replayer: payloads are not copied.
+        explicit TraceReplayer(const TraceReader& reader) {
+            std::map<uint32_t, Connection> by_id;
+            first_ns = UINT64_MAX;
+            reader.for_each([&](const TraceRecord& r) {
+                Connection& c = by_id[r.connection];
+                if (c.exchanges.empty()) {
+                    c.id = r.connection;
+                    c.protocol = r.protocol;
+                    c.start_ns = r.time_ns;
+                }
+                first_ns = std::min(first_ns, r.time_ns);
+                if (r.direction == TraceDirection::Send) {
+                    if (c.exchanges.empty() || c.exchanges.back().expect_bytes > 0) {
+                        c.exchanges.emplace_back();
+                        c.exchanges.back().time_ns = r.time_ns;
+                    }
+                    c.exchanges.back().sends.push_back({ r.payload, r.length });
+                } else {
+                    // Replies arriving before any send (server speaks first).
+                    if (c.exchanges.empty()) {
+                        c.exchanges.emplace_back();
+                        c.exchanges.back().time_ns = r.time_ns;
+                    }
+                    c.exchanges.back().expect_bytes += r.length;
+                    ++c.exchanges.back().expect_messages;
+                }
+            });
+            if (first_ns == UINT64_MAX) first_ns = 0;
+            for (auto& entry : by_id) {
+                // The first send may precede the first record in time order.
+                if (!entry.second.exchanges.empty())
+                    entry.second.start_ns = std::min(entry.second.start_ns, entry.second.exchanges.front().time_ns);
+                connections.push_back(std::move(entry.second));
+            }
+            std::sort(connections.begin(), connections.end(),
+                      [](const Connection& a, const Connection& b) { return a.start_ns < b.start_ns; });
+        }
+
+        size_t connection_count() const { return connections.size(); }
+
+        // Workers take connections in start order. With fewer threads than
+        // concurrently open connections, late starts show up in max_lag_ns.
+        ReplayReport run(const ReplayOptions& options) const {
+            unsigned threads = std::max(1u, options.threads);
+            std::vector<ReplayReport> reports(threads);
+            std::atomic<size_t> next{0};
+            auto epoch = clock::now();
+            std::vector<std::thread> workers;
+            for (unsigned t = 0; t < threads; ++t) {
+                workers.emplace_back([&, t] {
+                    for (size_t i; (i = next.fetch_add(1)) < connections.size();)
+                        replay_connection(connections[i], epoch, options, reports[t]);
+                });
+            }
+            for (std::thread& w : workers) w.join();
+            ReplayReport total;
+            for (const ReplayReport& r : reports) total.merge(r);
+            total.elapsed_ns = since_ns(epoch);
+            return total;
+        }
+    };
+}
+
+#endif // FMX_REPLAY_HPP
@@ -0,0 +1,512 @@
+#if !defined(FMX_RUDP_HPP)
+#define FMX_RUDP_HPP
+
+#include "udp.hpp"
+#include <poll.h>
+#include <sys/socket.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace fmx {
+    struct ReliableUdpStats {
+        uint64_t messages_sent = 0;
+        uint64_t messages_received = 0;
+        uint64_t packets_sent = 0;
+        uint64_t packets_received = 0;
+        uint64_t retransmits = 0;
+        uint64_t timeouts = 0;
+        uint64_t acks_sent = 0;
+        uint64_t duplicates = 0;
+        uint64_t dropped_by_shim = 0;
+        double srtt_ms = 0;
+        double cwnd = 0;
+    };
+
+    // Reliable message channel between two UdpImpl endpoints. Every message is
+    // delivered exactly once, either in send order (ordered) or as soon as it
+    // arrives (unordered). Losses are repaired from selective ACKs and RTO,
+    // the sending rate follows a NewReno-style congestion window and is paced
+    // over the smoothed RTT, and datagrams move in sendmmsg/recvmmsg batches.
+    //
+    // The channel is driven by the caller: send_message, recv_message, flush
+    // and pump all make progress. A side that never set_address learns its
+    // peer from the first packet it receives.
+    template <typename UdpType>
+    class ReliableUdp {
+    public:
+        static constexpr size_t header_size = 16;
+        static constexpr size_t max_packet = 1400;
+        static constexpr size_t max_message = max_packet - header_size;
+    private:
+        enum : uint8_t { kData = 1, kAck = 2 };
+        enum : uint8_t { kOrdered = 1 };
+        static constexpr size_t ack_header_size = 12;
+        static constexpr size_t batch_size = 32;
+        static constexpr size_t max_sack_ranges = 32;
+        static constexpr uint64_t max_window = 1024;
+        static constexpr uint64_t dup_threshold = 3;
+        static constexpr uint64_t min_rto_us = 5000;
+        static constexpr uint64_t max_rto_us = 2000000;
+
+        using clock = std::chrono::steady_clock;
+        struct Outstanding {
+            std::string packet;
+            uint64_t sent_us = 0;
+            uint64_t resent_after = 0; // next_tx when last (re)sent
+            bool queued = false;       // waiting in retransmit_queue
+        };
+
+        UdpType& udp;
+        struct sockaddr_storage peer{};
+        socklen_t peer_len = 0;
+        unsigned long long time_out = 0;
+
+        // Sender. Sequence numbers are 64-bit internally, 32-bit on the wire.
+        uint64_t next_seq = 0;          // assigned at enqueue
+        uint64_t next_tx = 0;           // first never-transmitted seq
+        uint64_t next_order_out = 0;
+        uint64_t snd_una = 0;           // peer's cumulative ack
+        uint64_t highest_acked = 0;     // one past the highest seq known received
+        uint64_t rack_sent_us = 0;      // send time of the most recently sent packet known received
+        std::deque<std::string> send_queue;
+        std::map<uint64_t, Outstanding> unacked;
+        std::deque<uint64_t> retransmit_queue;
+        double cwnd = 10;
+        double ssthresh = 1e9;
+        bool in_recovery = false;
+        uint64_t recovery_end = 0;
+        double srtt_us = 0;
+        double rttvar_us = 0;
+        uint64_t rto_us = 200000;
+        uint64_t next_send_us = 0;
+        uint64_t last_activity_us = 0;  // last transmission or ACK
+        bool probe_sent = false;
+
+        // Receiver
+        uint64_t rcv_next = 0;
+        std::set<uint64_t> out_of_order;
+        uint64_t next_order_in = 0;
+        std::map<uint64_t, std::string> reorder;
+        std::deque<std::string> delivered;
+        bool ack_pending = false;
+        uint32_t echo_ts = 0;           // timestamp of the latest data packet, echoed in ACKs
+
+        double loss_rate = 0;
+        std::mt19937 rng{ 12345 };
+        ReliableUdpStats stats;
+
+        static uint64_t now_us() {
+            return std::chrono::duration_cast<std::chrono::microseconds>(clock::now().time_since_epoch()).count();
+        }
+        // Never zero, so an echoed 0 means "no sample".
+        static uint32_t wire_ts(uint64_t now) { return static_cast<uint32_t>(now) | 1; }
+        static void put32(char* p, uint32_t v) {
+            p[0] = char(v >> 24); p[1] = char(v >> 16); p[2] = char(v >> 8); p[3] = char(v);
+        }
+        static uint32_t get32(const char* p) {
+            const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+            return (uint32_t(u[0]) << 24) | (uint32_t(u[1]) << 16) | (uint32_t(u[2]) << 8) | uint32_t(u[3]);
+        }
+        // Widens a 32-bit wire value to the 64-bit value nearest to ref.
+        static uint64_t extend(uint32_t wire, uint64_t ref) {
+            uint64_t value = (ref & ~uint64_t(0xffffffff)) | wire;
+            if (value + 0x80000000ull < ref) value += 0x100000000ull;
+            else if (value > ref + 0x80000000ull && value >= 0x100000000ull) value -= 0x100000000ull;
+            return value;
+        }
+
+        bool drop_by_shim() {
+            if (loss_rate <= 0) return false;
+            if (std::uniform_real_distribution<double>(0, 1)(rng) >= loss_rate) return false;
+            ++stats.dropped_by_shim;
+            return true;
+        }
+        int send_batch(std::vector<const std::string*>& batch) {
+            struct mmsghdr msgs[batch_size];
+            struct iovec iov[batch_size];
+            size_t count = 0;
+            for (const std::string* packet : batch) {
+                ++stats.packets_sent;
+                if (drop_by_shim()) continue;
+                iov[count].iov_base = const_cast<char*>(packet->data());
+                iov[count].iov_len = packet->size();
+                memset(&msgs[count], 0, sizeof(msgs[count]));
+                msgs[count].msg_hdr.msg_iov = &iov[count];
+                msgs[count].msg_hdr.msg_iovlen = 1;
+                msgs[count].msg_hdr.msg_name = &peer;
+                msgs[count].msg_hdr.msg_namelen = peer_len;
+                ++count;
+            }
+            batch.clear();
+            size_t done = 0;
+            while (done < count) {
+                int ret = sendmmsg(udp.get_fd(), msgs + done, count - done, 0);
+                if (ret < 0) return errno == EINTR ? 0 : -1;
+                done += ret;
+            }
+            return 0;
+        }
+        bool pacing_allows(uint64_t now) {
+            if (srtt_us <= 0) return true;
+            double interval = srtt_us / (cwnd * 1.25);
+            const double burst = 4;
+            if (double(next_send_us) > double(now) + burst * interval) return false;
+            double base = std::max(double(next_send_us), double(now) - burst * interval);
+            next_send_us = static_cast<uint64_t>(base + interval);
+            return true;
+        }
+        int flush_sends(uint64_t now) {
+            if (peer_len == 0) return 0;
+            std::vector<const std::string*> batch;
+            while (!retransmit_queue.empty()) {
+                auto it = unacked.find(retransmit_queue.front());
+                if (it == unacked.end() || !it->second.queued) {
+                    retransmit_queue.pop_front();
+                    continue;
+                }
+                if (!pacing_allows(now)) break;
+                retransmit_queue.pop_front();
+                it->second.queued = false;
+                it->second.sent_us = now;
+                put32(&it->second.packet[12], wire_ts(now));
+                it->second.resent_after = next_tx;
+                ++stats.retransmits;
+                batch.push_back(&it->second.packet);
+                if (batch.size() == batch_size && send_batch(batch) < 0) return -1;
+            }
+            while (!send_queue.empty() && unacked.size() < cwnd && next_tx - snd_una < max_window) {
+                if (!pacing_allows(now)) break;
+                Outstanding& out = unacked[next_tx];
+                out.packet = std::move(send_queue.front());
+                send_queue.pop_front();
+                out.sent_us = now;
+                put32(&out.packet[12], wire_ts(now));
+                out.resent_after = ++next_tx;
+                batch.push_back(&out.packet);
+                if (batch.size() == batch_size && send_batch(batch) < 0) return -1;
+            }
+            if (batch.empty()) return 0;
+            last_activity_us = now;
+            return send_batch(batch);
+        }
+        int send_ack() {
+            char packet[ack_header_size + max_sack_ranges * 8];
+            size_t len = ack_header_size;
+            size_t ranges = 0;
+            for (auto it = out_of_order.begin(); it != out_of_order.end() && ranges < max_sack_ranges; ++ranges) {
+                uint64_t start = *it, end = start + 1;
+                for (++it; it != out_of_order.end() && *it == end; ++it) ++end;
+                put32(packet + len, static_cast<uint32_t>(start));
+                put32(packet + len + 4, static_cast<uint32_t>(end));
+                len += 8;
+            }
+            packet[0] = char(kAck);
+            packet[1] = char(ranges);
+            packet[2] = packet[3] = 0;
+            put32(packet + 4, static_cast<uint32_t>(rcv_next));
+            put32(packet + 8, echo_ts);
+            ack_pending = false;
+            ++stats.acks_sent;
+            if (drop_by_shim()) return 0;
+            return sendto(udp.get_fd(), packet, len, 0, reinterpret_cast<struct sockaddr*>(&peer), peer_len) < 0 ? -1 : 0;
+        }
+
+        void on_loss(uint64_t seq, Outstanding& out) {
+            if (out.queued) return;
+            out.queued = true;
+            retransmit_queue.push_back(seq);
+            if (!in_recovery) {
+                ssthresh = std::max(cwnd / 2, 2.0);
+                cwnd = ssthresh;
+                in_recovery = true;
+                recovery_end = next_tx;
+            }
+        }
+        void on_acked(uint64_t seq, const Outstanding& out, uint64_t& newly_acked) {
+            if (seq + 1 > highest_acked) highest_acked = seq + 1;
+            if (out.sent_us > rack_sent_us) rack_sent_us = out.sent_us;
+            ++newly_acked;
+        }
+        void on_ack(const char* p, size_t len, uint64_t now) {
+            size_t ranges = static_cast<unsigned char>(p[1]);
+            if (len < ack_header_size + ranges * 8) return;
+            uint64_t cum = extend(get32(p + 4), snd_una);
+            if (cum > next_tx) return;
+            uint64_t newly_acked = 0;
+            uint32_t echoed = get32(p + 8);
+            last_activity_us = now;
+            probe_sent = false;
+            if (cum > snd_una) {
+                snd_una = cum;
+                while (!unacked.empty() && unacked.begin()->first < cum) {
+                    on_acked(unacked.begin()->first, unacked.begin()->second, newly_acked);
+                    unacked.erase(unacked.begin());
+                }
+            }
+            for (size_t i = 0; i < ranges; ++i) {
+                uint64_t start = extend(get32(p + ack_header_size + i * 8), snd_una);
+                uint64_t end = extend(get32(p + ack_header_size + i * 8 + 4), snd_una);
+                if (end > next_tx || start >= end) continue;
+                for (auto it = unacked.lower_bound(start); it != unacked.end() && it->first < end;) {
+                    on_acked(it->first, it->second, newly_acked);
+                    it = unacked.erase(it);
+                }
+            }
+            // Echoed timestamps give an unambiguous sample even for retransmits.
+            if (echoed) {
+                double sample = double(static_cast<uint32_t>(wire_ts(now) - echoed));
+                if (srtt_us <= 0) {
+                    srtt_us = sample;
+                    rttvar_us = sample / 2;
+                } else {
+                    rttvar_us = 0.75 * rttvar_us + 0.25 * std::abs(srtt_us - sample);
+                    srtt_us = 0.875 * srtt_us + 0.125 * sample;
+                }
+                rto_us = static_cast<uint64_t>(srtt_us + 4 * rttvar_us);
+                rto_us = std::min(std::max(rto_us, min_rto_us), max_rto_us);
+            }
+            if (in_recovery && snd_una >= recovery_end) in_recovery = false;
+            if (!in_recovery && newly_acked) {
+                if (cwnd < ssthresh) cwnd += double(newly_acked);
+                else cwnd += double(newly_acked) / cwnd;
+                cwnd = std::min(cwnd, double(max_window));
+            }
+            // A packet is lost once dup_threshold later packets have arrived, or
+            // (RACK) once a packet sent more than a quarter RTT after it has
+            // arrived. The latter also covers windows too small for dupthresh.
+            uint64_t reorder_window = static_cast<uint64_t>(srtt_us / 4);
+            for (auto& entry : unacked) {
+                if (entry.first >= highest_acked) break;
+                if (highest_acked >= entry.second.resent_after + dup_threshold ||
+                    entry.second.sent_us + reorder_window < rack_sent_us)
+                    on_loss(entry.first, entry.second);
+            }
+        }
+        void on_data(const char* p, size_t len) {
+            if (len < header_size) return;
+            echo_ts = get32(p + 12);
+            uint64_t seq = extend(get32(p + 4), rcv_next);
+            if (seq < rcv_next || out_of_order.count(seq)) {
+                ++stats.duplicates;
+                ack_pending = true;
+                return;
+            }
+            if (seq >= rcv_next + 2 * max_window) return;
+            if (seq == rcv_next) {
+                ++rcv_next;
+                while (!out_of_order.empty() && *out_of_order.begin() == rcv_next) {
+                    out_of_order.erase(out_of_order.begin());
+                    ++rcv_next;
+                }
+            } else {
+                out_of_order.insert(seq);
+            }
+            ack_pending = true;
+            ++stats.messages_received;
+            std::string payload(p + header_size, len - header_size);
+            if (!(p[1] & kOrdered)) {
+                delivered.push_back(std::move(payload));
+                return;
+            }
+            reorder.emplace(extend(get32(p + 8), next_order_in), std::move(payload));
+            while (!reorder.empty() && reorder.begin()->first == next_order_in) {
+                delivered.push_back(std::move(reorder.begin()->second));
+                reorder.erase(reorder.begin());
+                ++next_order_in;
+            }
+        }
+        int recv_batch(uint64_t now) {
+            char buffers[batch_size][max_packet];
+            struct mmsghdr msgs[batch_size];
+            struct iovec iov[batch_size];
+            struct sockaddr_storage from[batch_size];
+            memset(msgs, 0, sizeof(msgs));
+            for (size_t i = 0; i < batch_size; ++i) {
+                iov[i].iov_base = buffers[i];
+                iov[i].iov_len = max_packet;
+                msgs[i].msg_hdr.msg_iov = &iov[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+                msgs[i].msg_hdr.msg_name = &from[i];
+                msgs[i].msg_hdr.msg_namelen = sizeof(from[i]);
+            }
+            int n = recvmmsg(udp.get_fd(), msgs, batch_size, MSG_DONTWAIT, nullptr);
+            if (n < 0) return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+            for (int i = 0; i < n; ++i) {
+                size_t len = msgs[i].msg_len;
+                if (len < ack_header_size) continue;
+                if (peer_len == 0) {
+                    memcpy(&peer, &from[i], msgs[i].msg_hdr.msg_namelen);
+                    peer_len = msgs[i].msg_hdr.msg_namelen;
+                } else if (msgs[i].msg_hdr.msg_namelen != peer_len || memcmp(&from[i], &peer, peer_len) != 0) {
+                    continue;
+                }
+                ++stats.packets_received;
+                if (buffers[i][0] == char(kData)) on_data(buffers[i], len);
+                else if (buffers[i][0] == char(kAck)) on_ack(buffers[i], len, now);
+            }
+            if (ack_pending && send_ack() < 0) return -1;
+            return n;
+        }
+        // Queues every packet whose RTO expired; returns the next RTO deadline.
+        uint64_t check_timeouts(uint64_t now) {
+            uint64_t next_deadline = UINT64_MAX;
+            bool expired = false;
+            // Tail loss probe: when the line goes quiet for two RTTs, resend the
+            // newest packet so the peer's ACK reveals any holes well before RTO.
+            if (!unacked.empty() && !probe_sent && srtt_us > 0) {
+                uint64_t probe_at = last_activity_us + std::max(static_cast<uint64_t>(2 * srtt_us), uint64_t(1000));
+                if (probe_at <= now) {
+                    probe_sent = true;
+                    Outstanding& newest = unacked.rbegin()->second;
+                    if (!newest.queued) {
+                        newest.queued = true;
+                        retransmit_queue.push_back(unacked.rbegin()->first);
+                    }
+                } else {
+                    next_deadline = probe_at;
+                }
+            }
+            for (auto& entry : unacked) {
+                if (entry.second.queued) continue;
+                uint64_t deadline = entry.second.sent_us + rto_us;
+                if (deadline <= now) {
+                    entry.second.queued = true;
+                    retransmit_queue.push_back(entry.first);
+                    expired = true;
+                } else if (deadline < next_deadline) {
+                    next_deadline = deadline;
+                }
+            }
+            if (expired) {
+                ++stats.timeouts;
+                ssthresh = std::max(cwnd / 2, 2.0);
+                cwnd = 2;
+                in_recovery = true;
+                recovery_end = next_tx;
+                rto_us = std::min(rto_us * 2, max_rto_us);
+            }
+            return next_deadline;
+        }
+    public:
+        explicit ReliableUdp(UdpType& udp) : udp(udp) {
+            if (udp.get_server_addr()->sa_family != AF_UNSPEC) {
+                memcpy(&peer, udp.get_server_addr(), udp.get_addr_len());
+                peer_len = udp.get_addr_len();
+            }
+        }
+
+        // Bounds recv_message and flush; 0 waits forever.
+        void set_timeout(unsigned long long ms) { time_out = ms; }
+        // In-process loss shim: drops outgoing DATA and ACK packets with
+        // probability rate, for exercising recovery without netem.
+        void set_loss_rate(double rate, unsigned seed = 12345) {
+            loss_rate = rate;
+            rng.seed(seed);
+        }
+
+        // Queues a message (at most max_message bytes) and sends what the
+        // congestion window and pacing allow. Returns its size or -1.
+        int send_message(const std::string& data, bool ordered = true) {
+            if (data.size() > max_message) return -1;
+            std::string packet(header_size, '\0');
+            packet[0] = char(kData);
+            packet[1] = char(ordered ? kOrdered : 0);
+            put32(&packet[4], static_cast<uint32_t>(next_seq++));
+            put32(&packet[8], static_cast<uint32_t>(ordered ? next_order_out++ : 0));
+            packet += data;
+            send_queue.push_back(std::move(packet));
+            ++stats.messages_sent;
+            uint64_t now = now_us();
+            if (flush_sends(now) < 0) return -1;
+            // Window full: pick up pending ACKs without blocking.
+            if (!send_queue.empty()) {
+                if (recv_batch(now) < 0) return -1;
+                check_timeouts(now);
+                if (flush_sends(now) < 0) return -1;
+            }
+            return static_cast<int>(data.size());
+        }
+
+        // One round of I/O: waits up to wait_ms (-1 forever) for packets,
+        // processes ACKs and data, retransmits and paces out queued packets.
+        int pump(int wait_ms) {
+            uint64_t now = now_us();
+            uint64_t deadline = check_timeouts(now);
+            if (flush_sends(now) < 0) return -1;
+            if (!delivered.empty()) wait_ms = 0;
+            if (deadline != UINT64_MAX) {
+                int rto_wait = static_cast<int>((deadline - now + 999) / 1000);
+                if (wait_ms < 0 || rto_wait < wait_ms) wait_ms = rto_wait;
+            }
+            bool sendable = !retransmit_queue.empty() ||
+                            (!send_queue.empty() && unacked.size() < cwnd && next_tx - snd_una < max_window);
+            if (sendable && next_send_us > now) {
+                int pace_wait = static_cast<int>((next_send_us - now + 999) / 1000);
+                if (wait_ms < 0 || pace_wait < wait_ms) wait_ms = pace_wait;
+            }
+            struct pollfd pfd { udp.get_fd(), POLLIN, 0 };
+            int ready = poll(&pfd, 1, wait_ms);
+            if (ready < 0 && errno != EINTR) return -1;
+            now = now_us();
+            if (ready > 0) {
+                int n;
+                while ((n = recv_batch(now)) == static_cast<int>(batch_size)) {}
+                if (n < 0) return -1;
+            }
+            check_timeouts(now);
+            return flush_sends(now);
+        }
+
+        // Waits for the next deliverable message. Returns its size or -1.
+        int recv_message(std::string& result) {
+            auto start = clock::now();
+            while (delivered.empty()) {
+                int wait_ms = -1;
+                if (time_out > 0) {
+                    auto spent = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - start).count();
+                    if (static_cast<unsigned long long>(spent) >= time_out) return -1;
+                    wait_ms = static_cast<int>(time_out - spent);
+                }
+                if (pump(wait_ms) < 0) return -1;
+            }
+            result = std::move(delivered.front());
+            delivered.pop_front();
+            return static_cast<int>(result.size());
+        }
+
+        // Drives I/O until every queued message is acknowledged.
+        int flush() {
+            auto start = clock::now();
+            while (!send_queue.empty() || !unacked.empty()) {
+                int wait_ms = -1;
+                if (time_out > 0) {
+                    auto spent = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - start).count();
+                    if (static_cast<unsigned long long>(spent) >= time_out) return -1;
+                    wait_ms = static_cast<int>(time_out - spent);
+                }
+                if (pump(wait_ms) < 0) return -1;
+            }
+            return 0;
+        }
+
+        size_t pending() const { return send_queue.size() + unacked.size(); }
+        size_t deliverable() const { return delivered.size(); }
+        ReliableUdpStats get_stats() const {
+            ReliableUdpStats s = stats;
+            s.srtt_ms = srtt_us / 1000.0;
+            s.cwnd = cwnd;
+            return s;
+        }
+    };
+}
+
+#endif // FMX_RUDP_HPP
@@ -9,12 +9,14 @@
 #include <netdb.h>
 #include <sys/select.h>
 #include <cstring>
+#include "socket.hpp"
 
 namespace fmx {
     class SctpBase {
     protected:
         int socket_fd = -1;
         unsigned long long time_out = 0;
+        void on_open() {}
     public:
         SctpBase() = default;
         virtual ~SctpBase() { if (socket_fd >= 0) close_connection(); }
@@ -76,150 +78,37 @@ namespace fmx {
         }
     };
 
-    class SctpIPv4 : public SctpBase {
-    private:
-        struct sockaddr_in server_addr{};
-    public:
-        SctpIPv4() = default;
-        ~SctpIPv4() override = default;
-        
-        int initSctp() {
-            socket_fd = socket(AF_INET, SOCK_STREAM, IPPROTO_SCTP);
-            return socket_fd < 0 ? -1 : 0;
-        }
-        
-        int set_address(const char* ip, int port) {
-            server_addr.sin_family = AF_INET;
-            server_addr.sin_port = htons(port);
-            if (inet_pton(AF_INET, ip, &server_addr.sin_addr) <= 0) {
-                close(socket_fd);
-                return -1;
-            }
-            return 0;
-        }
-        
-        int bind_port(unsigned short port) {
-            struct sockaddr_in addr{};
-            addr.sin_family = AF_INET;
-            addr.sin_addr.s_addr = INADDR_ANY;
-            addr.sin_port = htons(port);
-            return bind(socket_fd, (struct sockaddr*)&addr, sizeof(addr));
-        }
-        
-        const struct sockaddr* get_server_addr() const { 
-            return reinterpret_cast<const struct sockaddr*>(&server_addr); 
-        }
-        
-        socklen_t get_addr_len() const { 
-            return sizeof(server_addr); 
-        }
-        
-        int connect_to_server() {
-            return connect(socket_fd, get_server_addr(), get_addr_len());
-        }
+    struct SctpStream {
+        using base_type = SctpBase;
+        static constexpr int type = SOCK_STREAM;
+        static constexpr int protocol = IPPROTO_SCTP;
     };
 
-    class SctpIPv6 : public SctpBase {
-    private:
-        struct sockaddr_in6 server_addr{};
+    template <typename Family>
+    class SctpImpl : public Socket<Family, SctpStream> {
     public:
-        SctpIPv6() = default;
-        ~SctpIPv6() override = default;
-        
-        int initSctp() {
-            socket_fd = socket(AF_INET6, SOCK_STREAM, IPPROTO_SCTP);
-            return socket_fd < 0 ? -1 : 0;
-        }
-        
-        int set_address(const char* ip, int port) {
-            server_addr.sin6_family = AF_INET6;
-            server_addr.sin6_port = htons(port);
-            if (inet_pton(AF_INET6, ip, &server_addr.sin6_addr) <= 0) {
-                close(socket_fd);
-                return -1;
-            }
-            return 0;
-        }
-        
-        int bind_port(unsigned short port) {
-            struct sockaddr_in6 addr{};
-            addr.sin6_family = AF_INET6;
-            addr.sin6_addr = in6addr_any;
-            addr.sin6_port = htons(port);
-            return bind(socket_fd, (struct sockaddr*)&addr, sizeof(addr));
-        }
+        SctpImpl() = default;
+        ~SctpImpl() override = default;
         
-        const struct sockaddr* get_server_addr() const { 
-            return reinterpret_cast<const struct sockaddr*>(&server_addr); 
-        }
-        
-        socklen_t get_addr_len() const { 
-            return sizeof(server_addr); 
-        }
+        int initSctp() { return this->open_socket(); }
         
         int connect_to_server() {
-            return connect(socket_fd, get_server_addr(), get_addr_len());
+            return connect(this->socket_fd, this->get_server_addr(), this->get_addr_len());
         }
     };
 
-    class SctpServerIPv4 {
-    private:
-        SctpIPv4 socket;
-    public:
-        SctpServerIPv4() = default;
-        ~SctpServerIPv4() = default;
-        
-        int bind_port(unsigned short port) {
-            if (socket.initSctp() < 0) return -1;
-            
-            // Enable SCTP notifications
-            struct sctp_event_subscribe events;
-            memset(&events, 0, sizeof(events));
-            events.sctp_data_io_event = 1;
-            setsockopt(socket.get_socket_fd(), IPPROTO_SCTP, SCTP_EVENTS, &events, sizeof(events));
-            
-            return socket.bind_port(port);
-        }
-        
-        int listen_connections(int backlog = 5) {
-            return listen(socket.get_socket_fd(), backlog);
-        }
-        
-        int accept_connection(struct sockaddr_in* client_addr) {
-            socklen_t addr_len = sizeof(*client_addr);
-            return accept(socket.get_socket_fd(), 
-                         reinterpret_cast<struct sockaddr*>(client_addr), 
-                         &addr_len);
-        }
-        
-        int recv_data(std::string& result, struct sockaddr_in* client_addr, int* stream_no = nullptr) {
-            socklen_t addr_len = sizeof(*client_addr);
-            return socket.recv_data(
-                result, 
-                reinterpret_cast<struct sockaddr*>(client_addr), 
-                &addr_len,
-                stream_no
-            );
-        }
-        
-        int send_data(const std::string& data, const struct sockaddr_in* client_addr, int stream_no = 0) {
-            return socket.send_data(
-                data, 
-                reinterpret_cast<const struct sockaddr*>(client_addr), 
-                sizeof(*client_addr),
-                stream_no
-            );
-        }
-        
-        int get_socket_fd() const { return socket.get_socket_fd(); }
-    };
+    using SctpIPv4 = SctpImpl<IPv4>;
+    using SctpIPv6 = SctpImpl<IPv6>;
 
-    class SctpServerIPv6 {
+    template <typename Family>
+    class SctpServer {
     private:
-        SctpIPv6 socket;
+        SctpImpl<Family> socket;
     public:
-        SctpServerIPv6() = default;
-        ~SctpServerIPv6() = default;
+        using sockaddr_type = typename Family::sockaddr_type;
+
+        SctpServer() = default;
+        ~SctpServer() = default;
         
         int bind_port(unsigned short port) {
             if (socket.initSctp() < 0) return -1;
@@ -237,14 +126,14 @@ namespace fmx {
             return listen(socket.get_socket_fd(), backlog);
         }
         
-        int accept_connection(struct sockaddr_in6* client_addr) {
+        int accept_connection(sockaddr_type* client_addr) {
             socklen_t addr_len = sizeof(*client_addr);
             return accept(socket.get_socket_fd(), 
                          reinterpret_cast<struct sockaddr*>(client_addr), 
                          &addr_len);
         }
         
-        int recv_data(std::string& result, struct sockaddr_in6* client_addr, int* stream_no = nullptr) {
+        int recv_data(std::string& result, sockaddr_type* client_addr, int* stream_no = nullptr) {
             socklen_t addr_len = sizeof(*client_addr);
             return socket.recv_data(
                 result, 
@@ -254,7 +143,7 @@ namespace fmx {
             );
         }
         
-        int send_data(const std::string& data, const struct sockaddr_in6* client_addr, int stream_no = 0) {
+        int send_data(const std::string& data, const sockaddr_type* client_addr, int stream_no = 0) {
             return socket.send_data(
                 data, 
                 reinterpret_cast<const struct sockaddr*>(client_addr), 
@@ -265,6 +154,9 @@ namespace fmx {
         
         int get_socket_fd() const { return socket.get_socket_fd(); }
     };
+
+    using SctpServerIPv4 = SctpServer<IPv4>;
+    using SctpServerIPv6 = SctpServer<IPv6>;
 }
 
 #endif // FMX_SCTP_HPP
\ No newline at end of file
@@ -0,0 +1,288 @@
+#if !defined(FMX_SHM_HPP)
+#define FMX_SHM_HPP
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+namespace fmx {
+    namespace detail {
+        inline int futex_wait(std::atomic<uint32_t>* word, uint32_t expected, unsigned long long ms) {
+            struct timespec ts;
+            ts.tv_sec = ms / 1000;
+            ts.tv_nsec = (ms % 1000) * 1000000;
+            return static_cast<int>(syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT,
+                                            expected, ms ? &ts : nullptr, nullptr, 0));
+        }
+        inline void futex_wake(std::atomic<uint32_t>* word) {
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+        }
+        inline constexpr uint32_t shm_ring_magic = 0x464d5852;    // "FMXR"
+        inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#elif defined(__aarch64__)
+            asm volatile("yield");
+#endif
+        }
+    }
+
+    // Single-producer/single-consumer byte ring living in shared memory.
+    // Positions only grow; a side sleeps on a futex only after spinning and
+    // after announcing itself, so the other side issues a wake syscall only
+    // when someone is actually asleep.
+    struct ShmRing {
+        alignas(64) std::atomic<uint64_t> head;     // written by producer
+        std::atomic<uint32_t> space_seq;            // producer sleeps here
+        std::atomic<uint32_t> producer_waiting;
+        alignas(64) std::atomic<uint64_t> tail;     // written by consumer
+        std::atomic<uint32_t> data_seq;             // consumer sleeps here
+        std::atomic<uint32_t> consumer_waiting;
+        alignas(64) std::atomic<uint32_t> closed;
+        std::atomic<uint32_t> ready;                // shm_ring_magic once both rings are set up
+        uint64_t capacity;                          // power of two
+
+        static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared atomics must be lock-free");
+
+        char* data() { return reinterpret_cast<char*>(this) + sizeof(ShmRing); }
+        void init(uint64_t cap) {
+            head.store(0);
+            tail.store(0);
+            space_seq.store(0);
+            data_seq.store(0);
+            producer_waiting.store(0);
+            consumer_waiting.store(0);
+            closed.store(0);
+            ready.store(0);
+            capacity = cap;
+        }
+    };
+
+    // Same-host transport over two ShmRings in a POSIX shared memory object.
+    // Offers the TcpBase surface (send_data/recv_data/recv_some/set_timeout)
+    // and the client hooks HttpImpl expects: set_address takes the segment
+    // name, connect_to_server attaches to a segment created by the peer.
+    class ShmChannel {
+    private:
+        // Spinning only pays off when the peer can run on another CPU.
+        static int spin_iterations() {
+            static const int spins = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? 2000 : 0;
+            return spins;
+        }
+        void* area = nullptr;
+        size_t area_size = 0;
+        ShmRing* tx = nullptr;
+        ShmRing* rx = nullptr;
+        std::string name;
+        bool owner = false;
+        unsigned long long time_out = 0;
+
+        static size_t ring_bytes(uint64_t cap) { return sizeof(ShmRing) + cap; }
+        // The attaching side only trusts the layout after the creator has
+        // published the ready word, and checks it fits the mapped size.
+        int map(int fd, size_t size, bool create_side) {
+            area = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd);
+            if (area == MAP_FAILED) {
+                area = nullptr;
+                return -1;
+            }
+            area_size = size;
+            char* base = static_cast<char*>(area);
+            ShmRing* first = reinterpret_cast<ShmRing*>(base);
+            if (!create_side) {
+                uint64_t cap = first->capacity;
+                if (first->ready.load(std::memory_order_acquire) != detail::shm_ring_magic ||
+                    cap == 0 || (cap & (cap - 1)) != 0 || cap > size || size < 2 * ring_bytes(cap)) {
+                    munmap(area, area_size);
+                    area = nullptr;
+                    return -1;
+                }
+            }
+            ShmRing* second = reinterpret_cast<ShmRing*>(base + ring_bytes(first->capacity));
+            tx = create_side ? first : second;
+            rx = create_side ? second : first;
+            return 0;
+        }
+        // Blocks until pred() holds, spinning first. Returns -1 on timeout.
+        template <typename Pred>
+        int wait_for(std::atomic<uint32_t>& seq, std::atomic<uint32_t>& waiting, Pred pred) {
+            for (int i = 0, spins = spin_iterations(); i < spins; ++i) {
+                if (pred()) return 0;
+                detail::cpu_relax();
+            }
+            auto start = std::chrono::steady_clock::now();
+            for (;;) {
+                uint32_t observed = seq.load();
+                waiting.store(1);
+                if (pred()) {
+                    waiting.store(0);
+                    return 0;
+                }
+                unsigned long long left = 0;
+                if (time_out > 0) {
+                    auto spent = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now() - start).count();
+                    if (static_cast<unsigned long long>(spent) >= time_out) {
+                        waiting.store(0);
+                        return -1;
+                    }
+                    left = time_out - spent;
+                }
+                detail::futex_wait(&seq, observed, left);
+                waiting.store(0);
+            }
+        }
+        static void notify(std::atomic<uint32_t>& seq, std::atomic<uint32_t>& waiting) {
+            if (waiting.load()) {
+                seq.fetch_add(1);
+                detail::futex_wake(&seq);
+            }
+        }
+    public:
+        ShmChannel() = default;
+        ~ShmChannel() { close_connection(); }
+        ShmChannel(const ShmChannel&) = delete;
+        ShmChannel& operator=(const ShmChannel&) = delete;
+
+        static constexpr int get_address_family() { return AF_UNIX; }
+        void set_timeout(unsigned long long ms) { time_out = ms; }
+
+        // Creates the segment "name" (e.g. "/fmx-rpc") with two rings of at
+        // least capacity bytes each. The creator unlinks it on close.
+        int create(const char* segment, size_t capacity = 1 << 20) {
+            uint64_t cap = 4096;
+            while (cap < capacity) cap <<= 1;
+            int fd = shm_open(segment, O_CREAT | O_EXCL | O_RDWR, 0600);
+            if (fd < 0) return -1;
+            size_t size = 2 * ring_bytes(cap);
+            if (ftruncate(fd, size) < 0) {
+                close(fd);
+                shm_unlink(segment);
+                return -1;
+            }
+            void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (p == MAP_FAILED) {
+                close(fd);
+                shm_unlink(segment);
+                return -1;
+            }
+            reinterpret_cast<ShmRing*>(p)->init(cap);
+            reinterpret_cast<ShmRing*>(static_cast<char*>(p) + ring_bytes(cap))->init(cap);
+            reinterpret_cast<ShmRing*>(p)->ready.store(detail::shm_ring_magic, std::memory_order_release);
+            munmap(p, size);
+            name = segment;
+            owner = true;
+            if (map(fd, size, true) < 0) {
+                close_connection();
+                return -1;
+            }
+            return 0;
+        }
+        // Attaches to a segment created by the peer. Fails if the creator has
+        // not finished setting it up yet, or the segment is not a ShmChannel.
+        int attach(const char* segment) {
+            int fd = shm_open(segment, O_RDWR, 0600);
+            if (fd < 0) return -1;
+            struct stat st;
+            if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < sizeof(ShmRing)) {
+                close(fd);
+                return -1;
+            }
+            name = segment;
+            return map(fd, st.st_size, false);
+        }
+
+        int initTcp() { return 0; }
+        int set_address(const char* segment, int /*port*/) {
+            if (!segment || !*segment) return -1;
+            name = segment;
+            return 0;
+        }
+        int connect_to_server() { return attach(name.c_str()); }
+
+        int send_data(const std::string& data) {
+            if (!tx) return -1;
+            const char* buf = data.data();
+            size_t length = data.size();
+            size_t total_sent = 0;
+            while (total_sent < length) {
+                uint64_t head = tx->head.load(std::memory_order_relaxed);
+                auto has_space = [&] { return tx->closed.load() || head - tx->tail.load() < tx->capacity; };
+                if (wait_for(tx->space_seq, tx->producer_waiting, has_space) < 0 || tx->closed.load()) break;
+                uint64_t space = tx->capacity - (head - tx->tail.load(std::memory_order_acquire));
+                size_t chunk = std::min<uint64_t>(space, length - total_sent);
+                size_t offset = head & (tx->capacity - 1);
+                size_t first = std::min<size_t>(chunk, tx->capacity - offset);
+                memcpy(tx->data() + offset, buf + total_sent, first);
+                memcpy(tx->data(), buf + total_sent + first, chunk - first);
+                tx->head.store(head + chunk);
+                notify(tx->data_seq, tx->consumer_waiting);
+                total_sent += chunk;
+            }
+            return total_sent == length ? static_cast<int>(total_sent) : -1;
+        }
+        // Reads whatever is available (at most length bytes). Returns 0 once
+        // the peer closed and the ring is drained, -1 on timeout.
+        int recv_some(char* buffer, size_t length) {
+            if (!rx) return -1;
+            uint64_t tail = rx->tail.load(std::memory_order_relaxed);
+            auto has_data = [&] { return rx->closed.load() || rx->head.load() != tail; };
+            if (wait_for(rx->data_seq, rx->consumer_waiting, has_data) < 0) return -1;
+            uint64_t available = rx->head.load(std::memory_order_acquire) - tail;
+            if (available == 0) return 0;
+            size_t chunk = std::min<uint64_t>(available, length);
+            size_t offset = tail & (rx->capacity - 1);
+            size_t first = std::min<size_t>(chunk, rx->capacity - offset);
+            memcpy(buffer, rx->data() + offset, first);
+            memcpy(buffer + first, rx->data(), chunk - first);
+            rx->tail.store(tail + chunk);
+            notify(rx->space_seq, rx->producer_waiting);
+            return static_cast<int>(chunk);
+        }
+        int recv_data(std::string& result, size_t length) {
+            result.clear();
+            result.reserve(length);
+            size_t total_received = 0;
+            char buffer[4096];
+            while (total_received < length) {
+                int received_bytes = recv_some(buffer, std::min(sizeof(buffer), length - total_received));
+                if (received_bytes <= 0) break;
+                result.append(buffer, received_bytes);
+                total_received += received_bytes;
+            }
+            return static_cast<int>(total_received);
+        }
+        void close_connection() {
+            if (area) {
+                for (ShmRing* ring : { tx, rx }) {
+                    ring->closed.store(1);
+                    ring->data_seq.fetch_add(1);
+                    ring->space_seq.fetch_add(1);
+                    detail::futex_wake(&ring->data_seq);
+                    detail::futex_wake(&ring->space_seq);
+                }
+                munmap(area, area_size);
+                area = nullptr;
+                tx = rx = nullptr;
+            }
+            if (owner) {
+                shm_unlink(name.c_str());
+                owner = false;
+            }
+        }
+    };
+}
+
+#endif // FMX_SHM_HPP
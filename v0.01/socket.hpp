@@ -0,0 +1,87 @@
+#if !defined(FMX_SOCKET_HPP)
+#define FMX_SOCKET_HPP
+
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+namespace fmx {
+    // Address-family policies: the sockaddr type and how to fill it, resolved
+    // at compile time so no code path branches on the family.
+    struct IPv4 {
+        using sockaddr_type = struct sockaddr_in;
+        static constexpr int domain = AF_INET;
+        static int set_address(sockaddr_type& addr, const char* ip, int port) {
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(port);
+            return inet_pton(AF_INET, ip, &addr.sin_addr) == 1 ? 0 : -1;
+        }
+        static void set_any(sockaddr_type& addr, unsigned short port) {
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = INADDR_ANY;
+            addr.sin_port = htons(port);
+        }
+    };
+
+    struct IPv6 {
+        using sockaddr_type = struct sockaddr_in6;
+        static constexpr int domain = AF_INET6;
+        static int set_address(sockaddr_type& addr, const char* ip, int port) {
+            addr.sin6_family = AF_INET6;
+            addr.sin6_port = htons(port);
+            return inet_pton(AF_INET6, ip, &addr.sin6_addr) == 1 ? 0 : -1;
+        }
+        static void set_any(sockaddr_type& addr, unsigned short port) {
+            addr.sin6_family = AF_INET6;
+            addr.sin6_addr = in6addr_any;
+            addr.sin6_port = htons(port);
+        }
+    };
+
+    // Common core of every concrete socket. Protocol supplies the socket type
+    // and the non-virtual base carrying send/recv (TcpBase, UdpBase, SctpBase),
+    // so calls through a concrete Socket are resolved statically.
+    template <typename Family, typename Protocol>
+    class Socket : public Protocol::base_type {
+    protected:
+        typename Family::sockaddr_type server_addr{};
+
+        int open_socket() {
+            this->socket_fd = socket(Family::domain, Protocol::type, Protocol::protocol);
+            if (this->socket_fd < 0) return -1;
+            this->on_open();
+            return 0;
+        }
+    public:
+        using family_type = Family;
+        using protocol_type = Protocol;
+        using sockaddr_type = typename Family::sockaddr_type;
+
+        static constexpr int get_address_family() { return Family::domain; }
+
+        void set_fd(int fd) { this->socket_fd = fd; }
+
+        int set_address(const char* ip, int port) {
+            if (Family::set_address(server_addr, ip, port) < 0) {
+                this->close_connection();
+                return -1;
+            }
+            return 0;
+        }
+
+        int bind_port(unsigned short port) {
+            sockaddr_type addr{};
+            Family::set_any(addr, port);
+            return bind(this->socket_fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+        }
+
+        const struct sockaddr* get_server_addr() const {
+            return reinterpret_cast<const struct sockaddr*>(&server_addr);
+        }
+
+        static constexpr socklen_t get_addr_len() { return sizeof(sockaddr_type); }
+    };
+}
+
+#endif // FMX_SOCKET_HPP
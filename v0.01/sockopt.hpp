@@ -0,0 +1,91 @@
+#if !defined(FMX_SOCKOPT_HPP)
+#define FMX_SOCKOPT_HPP
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+namespace fmx {
+    // Declarative socket tuning. Fields left at their defaults are not
+    // touched, so an empty profile keeps the kernel defaults.
+    struct SocketProfile {
+        int nodelay = -1;           // TCP_NODELAY (0/1)
+        int quickack = -1;          // TCP_QUICKACK (0/1), not sticky on Linux
+        int send_buffer = 0;        // SO_SNDBUF bytes
+        int recv_buffer = 0;        // SO_RCVBUF bytes
+        int busy_poll_us = 0;       // SO_BUSY_POLL
+        int notsent_lowat = 0;      // TCP_NOTSENT_LOWAT bytes
+        int defer_accept_s = 0;     // TCP_DEFER_ACCEPT, listeners only
+        int fastopen_queue = 0;     // TCP_FASTOPEN pending queue, listeners only
+        bool fastopen_connect = false; // TCP_FASTOPEN_CONNECT, clients only
+
+        static SocketProfile low_latency_rpc() {
+            SocketProfile p;
+            p.nodelay = 1;
+            p.quickack = 1;
+            p.busy_poll_us = 50;
+            p.notsent_lowat = 16 * 1024;
+            p.defer_accept_s = 1;
+            p.fastopen_queue = 256;
+            p.fastopen_connect = true;
+            return p;
+        }
+        static SocketProfile bulk_transfer() {
+            SocketProfile p;
+            p.nodelay = 0;
+            p.send_buffer = 4 * 1024 * 1024;
+            p.recv_buffer = 4 * 1024 * 1024;
+            return p;
+        }
+    };
+
+    namespace detail {
+        inline int set_int_option(int fd, int level, int name, int value) {
+            return setsockopt(fd, level, name, &value, sizeof(value));
+        }
+    }
+
+    // Applies the per-socket options. TCP-level options are skipped when
+    // stream is false. Every requested option is attempted; returns -1 if
+    // any of them failed.
+    inline int apply_socket_profile(int fd, const SocketProfile& p, bool stream = true) {
+        int ret = 0;
+        if (p.send_buffer > 0 && detail::set_int_option(fd, SOL_SOCKET, SO_SNDBUF, p.send_buffer) < 0) ret = -1;
+        if (p.recv_buffer > 0 && detail::set_int_option(fd, SOL_SOCKET, SO_RCVBUF, p.recv_buffer) < 0) ret = -1;
+#if defined(SO_BUSY_POLL)
+        if (p.busy_poll_us > 0 && detail::set_int_option(fd, SOL_SOCKET, SO_BUSY_POLL, p.busy_poll_us) < 0) ret = -1;
+#endif
+        if (!stream) return ret;
+        if (p.nodelay >= 0 && detail::set_int_option(fd, IPPROTO_TCP, TCP_NODELAY, p.nodelay) < 0) ret = -1;
+#if defined(TCP_QUICKACK)
+        if (p.quickack >= 0 && detail::set_int_option(fd, IPPROTO_TCP, TCP_QUICKACK, p.quickack) < 0) ret = -1;
+#endif
+#if defined(TCP_NOTSENT_LOWAT)
+        if (p.notsent_lowat > 0 && detail::set_int_option(fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, p.notsent_lowat) < 0) ret = -1;
+#endif
+        return ret;
+    }
+
+    // Client side: lets connect() defer the SYN so the first send carries data.
+    inline int apply_connect_profile(int fd, const SocketProfile& p) {
+        int ret = apply_socket_profile(fd, p, true);
+#if defined(TCP_FASTOPEN_CONNECT)
+        if (p.fastopen_connect && detail::set_int_option(fd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, 1) < 0) ret = -1;
+#endif
+        return ret;
+    }
+
+    // Listener side; must run before listen() for TCP_FASTOPEN to take effect.
+    inline int apply_listen_profile(int fd, const SocketProfile& p) {
+        int ret = apply_socket_profile(fd, p, true);
+#if defined(TCP_DEFER_ACCEPT)
+        if (p.defer_accept_s > 0 && detail::set_int_option(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, p.defer_accept_s) < 0) ret = -1;
+#endif
+#if defined(TCP_FASTOPEN)
+        if (p.fastopen_queue > 0 && detail::set_int_option(fd, IPPROTO_TCP, TCP_FASTOPEN, p.fastopen_queue) < 0) ret = -1;
+#endif
+        return ret;
+    }
+}
+
+#endif // FMX_SOCKOPT_HPP
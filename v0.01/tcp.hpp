@@ -5,16 +5,31 @@
 #include <string>
 #include <fcntl.h>
 #include <netdb.h>
+#include "sockopt.hpp"
+#include "socket.hpp"
 
 namespace fmx {
     class TcpBase {
     protected:
         int socket_fd = -1;
         unsigned long long time_out = 0;
+        SocketProfile profile;
+        void on_open() { apply_connect_profile(socket_fd, profile); }
     public:
         TcpBase() = default;
         virtual ~TcpBase() { if (socket_fd >= 0) close_connection(); }
+        int get_fd() const { return socket_fd; }
         void set_timeout(unsigned long long ms) { time_out = ms; }
+        // Stored and applied at initTcp; applied immediately if already open.
+        int set_profile(const SocketProfile& p) {
+            profile = p;
+            return socket_fd >= 0 ? apply_connect_profile(socket_fd, profile) : 0;
+        }
+        // While corked, partial frames are held back until uncorked (TCP_CORK).
+        int set_cork(bool on) {
+            int value = on ? 1 : 0;
+            return setsockopt(socket_fd, IPPROTO_TCP, TCP_CORK, &value, sizeof(value));
+        }
         int send_data(const std::string& data) {
             size_t total_sent = 0;
             const char* buf = data.data();
@@ -62,191 +77,159 @@ namespace fmx {
             }
             return static_cast<int>(total_received);
         }
+        // Reads whatever is available (at most length bytes) with a single recv.
+        int recv_some(char* buffer, size_t length) {
+            if (time_out > 0) {
+                fd_set read_set;
+                FD_ZERO(&read_set);
+                FD_SET(socket_fd, &read_set);
+                struct timeval tv;
+                tv.tv_sec = time_out / 1000;
+                tv.tv_usec = (time_out % 1000) * 1000;
+                if (select(socket_fd + 1, &read_set, nullptr, nullptr, &tv) <= 0)
+                    return -1;
+            }
+            ssize_t received_bytes = recv(socket_fd, buffer, length, 0);
+            if (received_bytes < 0) return -1;
+            return static_cast<int>(received_bytes);
+        }
         void close_connection() {
             close(socket_fd);
             socket_fd = -1;
         }
     };
 
-    class TcpIPv4 : public TcpBase {
-    public:
-        void set_fd(int fd) { socket_fd = fd; }
-    private:
-        struct sockaddr_in server_addr{};
+    struct Stream {
+        using base_type = TcpBase;
+        static constexpr int type = SOCK_STREAM;
+        static constexpr int protocol = 0;
+    };
+
+    template <typename Family, typename Protocol = Stream>
+    class TcpImpl : public Socket<Family, Protocol> {
     public:
-        TcpIPv4() = default;
-        ~TcpIPv4() override = default;
-        int initTcp() {
-            socket_fd = socket(AF_INET, SOCK_STREAM, 0);
-            if (socket_fd < 0) return -1;
-            return 0;
-        }
-        int set_address(const char* ip, int port) {
-            server_addr.sin_family = AF_INET;
-            server_addr.sin_port = htons(port);
-            if (inet_pton(AF_INET, ip, &server_addr.sin_addr) <= 0) {
-                close(socket_fd);
-                return -1;
-            }
-            return 0;
-        }
+        TcpImpl() = default;
+        ~TcpImpl() override = default;
+        int initTcp() { return this->open_socket(); }
         int connect_to_server() {
-            if (time_out == 0) {
-                if (connect(socket_fd, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-                    close(socket_fd);
+            int fd = this->socket_fd;
+            const struct sockaddr* addr = this->get_server_addr();
+            if (this->time_out == 0) {
+                if (connect(fd, addr, this->get_addr_len()) < 0) {
+                    this->close_connection();
                     return -1;
                 }
                 return 0;
             }
-            int flags = fcntl(socket_fd, F_GETFL, 0);
-            fcntl(socket_fd, F_SETFL, flags | O_NONBLOCK);
-            int ret = connect(socket_fd, (struct sockaddr*)&server_addr, sizeof(server_addr));
+            int flags = fcntl(fd, F_GETFL, 0);
+            fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+            int ret = connect(fd, addr, this->get_addr_len());
             if (ret == 0) {
-                fcntl(socket_fd, F_SETFL, flags);
+                fcntl(fd, F_SETFL, flags);
                 return 0;
             }
             if (errno != EINPROGRESS) {
-                close(socket_fd);
+                this->close_connection();
                 return -1;
             }
             fd_set wfds;
             FD_ZERO(&wfds);
-            FD_SET(socket_fd, &wfds);
+            FD_SET(fd, &wfds);
             struct timeval tv;
-            tv.tv_sec = time_out / 1000;
-            tv.tv_usec = (time_out % 1000) * 1000;
-            ret = select(socket_fd + 1, nullptr, &wfds, nullptr, &tv);
+            tv.tv_sec = this->time_out / 1000;
+            tv.tv_usec = (this->time_out % 1000) * 1000;
+            ret = select(fd + 1, nullptr, &wfds, nullptr, &tv);
             if (ret <= 0) {
-                close(socket_fd);
+                this->close_connection();
                 return -1;
             }
             int so_error = 0;
             socklen_t len = sizeof(so_error);
-            getsockopt(socket_fd, SOL_SOCKET, SO_ERROR, &so_error, &len);
-            fcntl(socket_fd, F_SETFL, flags);
+            getsockopt(fd, SOL_SOCKET, SO_ERROR, &so_error, &len);
+            fcntl(fd, F_SETFL, flags);
             if (so_error != 0) {
-                close(socket_fd);
+                this->close_connection();
                 return -1;
             }
             return 0;
         }
-    };
-
-    class TcpIPv6 : public TcpBase {
-    public:
-        void set_fd(int fd) { socket_fd = fd; }
-    private:
-        struct sockaddr_in6 server_addr{};
-    public:
-        TcpIPv6() = default;
-        ~TcpIPv6() override = default;
-        int initTcp() {
-            socket_fd = socket(AF_INET6, SOCK_STREAM, 0);
-            if (socket_fd < 0) return -1;
-            return 0;
-        }
-        int set_address(const char* ip, int port) {
-            server_addr.sin6_family = AF_INET6;
-            server_addr.sin6_port = htons(port);
-            if (inet_pton(AF_INET6, ip, &server_addr.sin6_addr) <= 0) {
-                close(socket_fd);
-                return -1;
-            }
-            return 0;
-        }
-        int connect_to_server() {
-            if (time_out == 0) {
-                if (connect(socket_fd, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-                    close(socket_fd);
+        // TCP Fast Open: carries data in the SYN when the server has handed
+        // out a cookie, otherwise degrades to a regular handshake. With a
+        // time_out the handshake is bounded like connect_to_server.
+        int connect_with_data(const std::string& data) {
+            int fd = this->socket_fd;
+            if (this->time_out == 0) {
+                ssize_t sent = sendto(fd, data.data(), data.size(), MSG_FASTOPEN,
+                                      this->get_server_addr(), this->get_addr_len());
+                if (sent < 0) {
+                    this->close_connection();
                     return -1;
                 }
-                return 0;
-            }
-            int flags = fcntl(socket_fd, F_GETFL, 0);
-            fcntl(socket_fd, F_SETFL, flags | O_NONBLOCK);
-            int ret = connect(socket_fd, (struct sockaddr*)&server_addr, sizeof(server_addr));
-            if (ret == 0) {
-                fcntl(socket_fd, F_SETFL, flags);
-                return 0;
+                if (static_cast<size_t>(sent) == data.size()) return static_cast<int>(sent);
+                int rest = this->send_data(data.substr(sent));
+                return rest < 0 ? -1 : static_cast<int>(sent) + rest;
             }
-            if (errno != EINPROGRESS) {
-                close(socket_fd);
-                return -1;
+            int flags = fcntl(fd, F_GETFL, 0);
+            fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+            // Without a cookie nothing is queued and the call fails with
+            // EINPROGRESS; with one the SYN carries data and the handshake
+            // may still be in flight, so wait for writability either way.
+            ssize_t sent = sendto(fd, data.data(), data.size(), MSG_FASTOPEN,
+                                  this->get_server_addr(), this->get_addr_len());
+            if (sent < 0) {
+                if (errno != EINPROGRESS) {
+                    this->close_connection();
+                    return -1;
+                }
+                sent = 0;
             }
             fd_set wfds;
             FD_ZERO(&wfds);
-            FD_SET(socket_fd, &wfds);
+            FD_SET(fd, &wfds);
             struct timeval tv;
-            tv.tv_sec = time_out / 1000;
-            tv.tv_usec = (time_out % 1000) * 1000;
-            ret = select(socket_fd + 1, nullptr, &wfds, nullptr, &tv);
-            if (ret <= 0) {
-                close(socket_fd);
+            tv.tv_sec = this->time_out / 1000;
+            tv.tv_usec = (this->time_out % 1000) * 1000;
+            if (select(fd + 1, nullptr, &wfds, nullptr, &tv) <= 0) {
+                this->close_connection();
                 return -1;
             }
             int so_error = 0;
             socklen_t len = sizeof(so_error);
-            getsockopt(socket_fd, SOL_SOCKET, SO_ERROR, &so_error, &len);
-            fcntl(socket_fd, F_SETFL, flags);
+            getsockopt(fd, SOL_SOCKET, SO_ERROR, &so_error, &len);
+            fcntl(fd, F_SETFL, flags);
             if (so_error != 0) {
-                close(socket_fd);
+                this->close_connection();
                 return -1;
             }
-            return 0;
+            if (static_cast<size_t>(sent) == data.size()) return static_cast<int>(sent);
+            int rest = this->send_data(data.substr(sent));
+            return rest < 0 ? -1 : static_cast<int>(sent) + rest;
         }
     };
-    class TcpServerIPv4 {
-    private:
-        int listen_fd = -1;
-        unsigned short port = 0;
-    public:
-        TcpServerIPv4() = default;
-        ~TcpServerIPv4() { if (listen_fd >= 0) close(listen_fd); }
-        int bind_port(unsigned short p) {
-            port = p;
-            listen_fd = socket(AF_INET, SOCK_STREAM, 0);
-            if (listen_fd < 0) return -1;
-            int opt = 1;
-            setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
-            struct sockaddr_in addr{};
-            addr.sin_family = AF_INET;
-            addr.sin_addr.s_addr = INADDR_ANY;
-            addr.sin_port = htons(port);
-            if (bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) return -1;
-            return 0;
-        }
-        int start_listen(int backlog = 5) {
-            if (listen(listen_fd, backlog) < 0) return -1;
-            return 0;
-        }
-        TcpIPv4 accept_client() {
-            struct sockaddr_in cli_addr{};
-            socklen_t cli_len = sizeof(cli_addr);
-            int client_fd = accept(listen_fd, (struct sockaddr*)&cli_addr, &cli_len);
-            TcpIPv4 cli;
-            cli.set_fd(client_fd);
-            return cli;
-        }
-        int get_fd() const { return listen_fd; }
-    };
 
-    class TcpServerIPv6 {
+    using TcpIPv4 = TcpImpl<IPv4>;
+    using TcpIPv6 = TcpImpl<IPv6>;
+
+    template <typename Family>
+    class TcpServer {
     private:
         int listen_fd = -1;
         unsigned short port = 0;
+        SocketProfile profile;
     public:
-        TcpServerIPv6() = default;
-        ~TcpServerIPv6() { if (listen_fd >= 0) close(listen_fd); }
+        TcpServer() = default;
+        ~TcpServer() { if (listen_fd >= 0) close(listen_fd); }
+        // Applied to the listener at bind_port and to every accepted client.
+        void set_profile(const SocketProfile& p) { profile = p; }
         int bind_port(unsigned short p) {
             port = p;
-            listen_fd = socket(AF_INET6, SOCK_STREAM, 0);
+            listen_fd = socket(Family::domain, SOCK_STREAM, 0);
             if (listen_fd < 0) return -1;
             int opt = 1;
             setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
-            struct sockaddr_in6 addr{};
-            addr.sin6_family = AF_INET6;
-            addr.sin6_addr = in6addr_any;
-            addr.sin6_port = htons(port);
+            apply_listen_profile(listen_fd, profile);
+            typename Family::sockaddr_type addr{};
+            Family::set_any(addr, port);
             if (bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) return -1;
             return 0;
         }
@@ -254,16 +237,20 @@ namespace fmx {
             if (listen(listen_fd, backlog) < 0) return -1;
             return 0;
         }
-        TcpIPv6 accept_client() {
-            struct sockaddr_in6 cli_addr{};
+        TcpImpl<Family> accept_client() {
+            typename Family::sockaddr_type cli_addr{};
             socklen_t cli_len = sizeof(cli_addr);
             int client_fd = accept(listen_fd, (struct sockaddr*)&cli_addr, &cli_len);
-            TcpIPv6 cli;
+            if (client_fd >= 0) apply_socket_profile(client_fd, profile);
+            TcpImpl<Family> cli;
             cli.set_fd(client_fd);
             return cli;
         }
         int get_fd() const { return listen_fd; }
     };
+
+    using TcpServerIPv4 = TcpServer<IPv4>;
+    using TcpServerIPv6 = TcpServer<IPv6>;
 }
 
 #endif // FMX_TCP_HPP
\ No newline at end of file
@@ -0,0 +1,453 @@
+// Loopback tests. Build and run from this directory:
+//
+//   g++ -std=c++17 -O2 -pthread test.cpp -o test && ./test
+//
+// Exits non-zero if any check fails.
+#include "FmxNet.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace fmx;
+
+namespace {
+    int failures = 0;
+
+#define CHECK(cond)                                                          \
+    do {                                                                     \
+        if (!(cond)) {                                                       \
+            printf("  FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond);       \
+            ++failures;                                                      \
+        }                                                                    \
+    } while (0)
+
+    using test_clock = std::chrono::steady_clock;
+
+    long long elapsed_ms(test_clock::time_point since) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(test_clock::now() - since).count();
+    }
+
+    // Raw listener on ip:port. Connections complete in the kernel without
+    // accept(), so nothing needs to serve it.
+    int listen_on(int family, const char* ip, unsigned short port, int backlog) {
+        struct sockaddr_storage addr{};
+        socklen_t len;
+        if (family == AF_INET) {
+            auto* v4 = reinterpret_cast<struct sockaddr_in*>(&addr);
+            v4->sin_family = AF_INET;
+            v4->sin_port = htons(port);
+            inet_pton(AF_INET, ip, &v4->sin_addr);
+            len = sizeof(*v4);
+        } else {
+            auto* v6 = reinterpret_cast<struct sockaddr_in6*>(&addr);
+            v6->sin6_family = AF_INET6;
+            v6->sin6_port = htons(port);
+            inet_pton(AF_INET6, ip, &v6->sin6_addr);
+            len = sizeof(*v6);
+        }
+        int fd = socket(family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return -1;
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (family == AF_INET6) setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &one, sizeof(one));
+        if (bind(fd, reinterpret_cast<struct sockaddr*>(&addr), len) < 0 || listen(fd, backlog) < 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    // A listener whose accept queue is full drops further SYNs, so connects
+    // to it hang until the client gives up: an artificially slow path.
+    int stalled_listener(int family, const char* ip, unsigned short port, std::vector<int>& fillers) {
+        int fd = listen_on(family, ip, port, 0);
+        if (fd < 0) return -1;
+        struct sockaddr_storage addr;
+        socklen_t len = sizeof(addr);
+        getsockname(fd, reinterpret_cast<struct sockaddr*>(&addr), &len);
+        for (int i = 0; i < 4; ++i) {
+            int c = socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            connect(c, reinterpret_cast<struct sockaddr*>(&addr), len);
+            fillers.push_back(c);
+        }
+        usleep(50 * 1000);
+        return fd;
+    }
+
+    void close_all(std::vector<int>& fds) {
+        for (int fd : fds)
+            if (fd >= 0) close(fd);
+        fds.clear();
+    }
+
+    // ---- TcpDualStack ---------------------------------------------------
+
+    void test_dualstack() {
+        printf("TcpDualStack\n");
+        const unsigned short port = 39701;
+        const unsigned long long delay = 100;
+        std::vector<int> fds;
+        int stalled = stalled_listener(AF_INET, "127.0.0.2", port, fds);
+        int live = listen_on(AF_INET, "127.0.0.1", port, 16);
+        CHECK(stalled >= 0 && live >= 0);
+        fds.push_back(stalled);
+        fds.push_back(live);
+
+        // The stalled candidate goes first; the live one must win one
+        // attempt_delay later, long before time_out.
+        {
+            TcpDualStack conn;
+            conn.set_timeout(3000);
+            conn.set_attempt_delay(delay);
+            auto start = test_clock::now();
+            int ret = conn.connect_to_any({ "127.0.0.2", "127.0.0.1" }, port);
+            long long ms = elapsed_ms(start);
+            CHECK(ret == 0);
+            CHECK(ms >= static_cast<long long>(delay) - 10 && ms < static_cast<long long>(delay) + 150);
+            CHECK(conn.get_connected_family() == AF_INET);
+            auto* peer = reinterpret_cast<const struct sockaddr_in*>(conn.get_peer_addr());
+            CHECK(peer->sin_addr.s_addr == htonl(INADDR_LOOPBACK));
+            printf("  stalled 127.0.0.2 vs live 127.0.0.1: won in %lld ms\n", ms);
+        }
+
+        // Live IPv6 first: wins without waiting and reports its family.
+        int v6 = listen_on(AF_INET6, "::1", port, 16);
+        if (v6 >= 0) {
+            fds.push_back(v6);
+            TcpDualStack conn;
+            conn.set_timeout(3000);
+            conn.set_attempt_delay(delay);
+            auto start = test_clock::now();
+            int ret = conn.connect_to_any({ "::1", "127.0.0.2" }, port);
+            long long ms = elapsed_ms(start);
+            CHECK(ret == 0);
+            CHECK(ms < static_cast<long long>(delay));
+            CHECK(conn.get_connected_family() == AF_INET6);
+            printf("  live ::1 vs stalled 127.0.0.2: won in %lld ms\n", ms);
+        } else {
+            printf("  no IPv6 loopback, skipping the AF_INET6 case\n");
+        }
+
+        // Every candidate refused: fails at once with -1.
+        {
+            TcpDualStack conn;
+            conn.set_timeout(3000);
+            conn.set_attempt_delay(delay);
+            auto start = test_clock::now();
+            int ret = conn.connect_to_any({ "127.0.0.1", "127.0.0.3" }, port + 1);
+            long long ms = elapsed_ms(start);
+            CHECK(ret == -1);
+            CHECK(ms < static_cast<long long>(delay));
+            CHECK(conn.get_connected_family() == AF_UNSPEC);
+            printf("  all refused: -1 in %lld ms\n", ms);
+        }
+
+        // Every candidate stalled: gives up at time_out with -1.
+        {
+            TcpDualStack conn;
+            conn.set_timeout(300);
+            conn.set_attempt_delay(delay);
+            auto start = test_clock::now();
+            int ret = conn.connect_to_any({ "127.0.0.2" }, port);
+            long long ms = elapsed_ms(start);
+            CHECK(ret == -1);
+            CHECK(ms >= 290 && ms < 600);
+            printf("  all stalled: -1 in %lld ms\n", ms);
+        }
+        close_all(fds);
+    }
+
+    // ---- Http2Client ----------------------------------------------------
+
+    // Minimal frame-level h2c server, one connection at a time, with the
+    // default 65535-byte windows and 16 KB frames. Paths:
+    //   /echo       answers with the request body
+    //   /headers    answers with the size of the request's x-big field and
+    //               an x-large field whose block spans CONTINUATION frames
+    //   /batch/...  held until batch_size arrived, then answered in reverse
+    //               order with their DATA frames interleaved
+    //   /goaway     sends GOAWAY naming this stream as the last one
+    class H2Peer {
+    private:
+        struct Request {
+            std::vector<hpack::Header> headers;
+            std::string body;
+            int64_t window = 65535;
+        };
+
+        TcpServerIPv4 listener;
+        std::thread worker;
+        hpack::Encoder encoder;
+        std::vector<uint32_t> batch;
+        uint32_t last_stream = UINT32_MAX;
+
+        static uint32_t read_u32(const std::string& s, size_t i) {
+            return (uint32_t(uint8_t(s[i])) << 24) | (uint32_t(uint8_t(s[i + 1])) << 16) |
+                   (uint32_t(uint8_t(s[i + 2])) << 8) | uint8_t(s[i + 3]);
+        }
+        static void put_u32(std::string& s, uint32_t v) {
+            char b[4] = { char(v >> 24), char(v >> 16), char(v >> 8), char(v) };
+            s.append(b, 4);
+        }
+        static void frame(std::string& out, uint8_t type, uint8_t flags, uint32_t id, const std::string& payload) {
+            size_t len = payload.size();
+            char h[9] = { char(len >> 16), char(len >> 8), char(len), char(type), char(flags),
+                          char(id >> 24), char(id >> 16), char(id >> 8), char(id) };
+            out.append(h, 9);
+            out += payload;
+        }
+        static std::string field(const Request& r, const char* name) {
+            for (const auto& h : r.headers)
+                if (h.name == name) return h.value;
+            return "";
+        }
+
+        // HEADERS (split into CONTINUATION pieces of at most fragment bytes)
+        // followed by DATA frames.
+        void respond_head(std::string& out, uint32_t id, std::vector<hpack::Header> headers,
+                          bool end_stream, size_t fragment = 16384) {
+            headers.insert(headers.begin(), { ":status", "200" });
+            std::string block;
+            encoder.encode(headers, block);
+            for (size_t offset = 0, type = 0x1; offset < block.size(); type = 0x9) {
+                size_t n = std::min(fragment, block.size() - offset);
+                uint8_t flags = offset + n == block.size() ? 0x4 : 0;
+                if (type == 0x1 && end_stream) flags |= 0x1;
+                frame(out, static_cast<uint8_t>(type), flags, id, block.substr(offset, n));
+                offset += n;
+            }
+        }
+        void respond(std::string& out, uint32_t id, const std::string& body,
+                     std::vector<hpack::Header> headers = {}, size_t fragment = 16384) {
+            respond_head(out, id, std::move(headers), body.empty(), fragment);
+            for (size_t offset = 0; offset < body.size(); offset += 16384) {
+                size_t n = std::min<size_t>(16384, body.size() - offset);
+                frame(out, 0x0, offset + n == body.size() ? 0x1 : 0, id, body.substr(offset, n));
+            }
+        }
+        void dispatch(TcpIPv4& conn, std::map<uint32_t, Request>& requests, uint32_t id) {
+            Request& r = requests[id];
+            std::string path = field(r, ":path"), out;
+            if (id > last_stream) return;   // after our GOAWAY: never processed
+            if (path == "/echo") {
+                respond(out, id, r.body);
+            } else if (path == "/headers") {
+                respond(out, id, std::to_string(field(r, "x-big").size()),
+                        { { "x-large", std::string(20000, 'L') } }, 8192);
+            } else if (path.compare(0, 7, "/batch/") == 0) {
+                batch.push_back(id);
+                if (batch.size() < batch_size) return;
+                // Every stream still open at once on this connection.
+                max_open_batch = batch.size();
+                std::vector<std::string> bodies;
+                for (auto it = batch.rbegin(); it != batch.rend(); ++it) {
+                    respond_head(out, *it, {}, false);
+                    std::string body;
+                    while (body.size() < 3000) body += field(requests[*it], ":path");
+                    bodies.push_back(body);
+                }
+                for (size_t offset = 0; offset < 3000; offset += 1000) {
+                    for (size_t i = 0; i < bodies.size(); ++i) {
+                        size_t n = std::min<size_t>(1000, bodies[i].size() - offset);
+                        bool last = offset + n == bodies[i].size();
+                        frame(out, 0x0, last ? 0x1 : 0, batch[batch.size() - 1 - i], bodies[i].substr(offset, n));
+                    }
+                }
+                batch.clear();
+            } else if (path == "/goaway") {
+                std::string p;
+                put_u32(p, id);
+                put_u32(p, 0);
+                frame(out, 0x7, 0, 0, p);
+                last_stream = id;
+                respond(out, id, "bye");
+            } else {
+                respond(out, id, "");
+            }
+            conn.send_data(out);
+        }
+        void serve(TcpIPv4& conn) {
+            std::string preface, h, p, out;
+            if (conn.recv_data(preface, 24) != 24 || preface != "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n") return;
+            frame(out, 0x4, 0, 0, "");
+            conn.send_data(out);
+            hpack::Decoder decoder;
+            std::map<uint32_t, Request> requests;
+            int64_t conn_window = 65535;
+            std::string block;
+            uint32_t block_stream = 0;
+            bool block_end_stream = false;
+            last_stream = UINT32_MAX;
+            while (conn.recv_data(h, 9) == 9) {
+                uint32_t len = (uint32_t(uint8_t(h[0])) << 16) | (uint32_t(uint8_t(h[1])) << 8) | uint8_t(h[2]);
+                uint8_t type = h[3], flags = h[4];
+                uint32_t id = read_u32(h, 5) & 0x7fffffff;
+                p.clear();
+                if (len > 16384) ++protocol_errors;
+                if (len && conn.recv_data(p, len) != static_cast<int>(len)) break;
+                out.clear();
+                if (type == 0x4 && !(flags & 0x1)) {
+                    frame(out, 0x4, 0x1, 0, "");
+                    conn.send_data(out);
+                } else if (type == 0x1 || type == 0x9) {
+                    if (type == 0x1) {
+                        block = p;
+                        block_stream = id;
+                        block_end_stream = flags & 0x1;
+                    } else {
+                        if (id != block_stream) ++protocol_errors;
+                        block += p;
+                        ++continuations_received;
+                    }
+                    if (flags & 0x4) {
+                        Request& r = requests[block_stream];
+                        if (decoder.decode(reinterpret_cast<const uint8_t*>(block.data()), block.size(), r.headers) < 0)
+                            ++protocol_errors;
+                        if (block_end_stream) dispatch(conn, requests, block_stream);
+                    }
+                } else if (type == 0x0) {
+                    Request& r = requests[id];
+                    // The client must stay inside both windows. Credit is only
+                    // granted once a window is used up, so a client ignoring
+                    // it overruns the window before any update could arrive.
+                    r.window -= len;
+                    conn_window -= len;
+                    if (r.window < 0 || conn_window < 0) ++flow_control_errors;
+                    r.body += p;
+                    if (conn_window <= 0) {
+                        std::string increment;
+                        put_u32(increment, static_cast<uint32_t>(65535 - conn_window));
+                        frame(out, 0x8, 0, 0, increment);
+                        conn_window = 65535;
+                        ++window_updates_sent;
+                    }
+                    if (r.window <= 0 && !(flags & 0x1)) {
+                        std::string increment;
+                        put_u32(increment, static_cast<uint32_t>(65535 - r.window));
+                        frame(out, 0x8, 0, id, increment);
+                        r.window = 65535;
+                        ++window_updates_sent;
+                    }
+                    if (!out.empty()) conn.send_data(out);
+                    if (flags & 0x1) dispatch(conn, requests, id);
+                }
+            }
+        }
+    public:
+        static constexpr size_t batch_size = 8;
+        // Read by the test after stop().
+        int connections = 0;
+        int continuations_received = 0;
+        int window_updates_sent = 0;
+        int flow_control_errors = 0;
+        int protocol_errors = 0;
+        size_t max_open_batch = 0;
+
+        int start(unsigned short port, int expected_connections) {
+            if (listener.bind_port(port) < 0 || listener.start_listen() < 0) return -1;
+            worker = std::thread([this, expected_connections] {
+                for (int i = 0; i < expected_connections; ++i) {
+                    TcpIPv4 conn = listener.accept_client();
+                    if (conn.get_fd() < 0) return;
+                    ++connections;
+                    serve(conn);
+                }
+            });
+            return 0;
+        }
+        void stop() {
+            if (worker.joinable()) worker.join();
+        }
+    };
+
+    void test_http2() {
+        printf("Http2Client\n");
+        const unsigned short port = 39702;
+        H2Peer peer;
+        CHECK(peer.start(port, 2) == 0);
+
+        // Many streams on one connection, a flow-controlled upload and
+        // header blocks split over CONTINUATION in both directions.
+        {
+            Http2v4 client;
+            client.set_port(port);
+            client.setTimeout(5000);
+            CHECK(client.initHttp("127.0.0.1") == 0);
+            CHECK(client.connectToServer() == 0);
+            std::vector<int> batch;
+            for (size_t i = 0; i < H2Peer::batch_size; ++i)
+                batch.push_back(client.GET("/batch/" + std::to_string(i)));
+            std::string upload(200000, '\0');
+            for (size_t i = 0; i < upload.size(); ++i) upload[i] = static_cast<char>('a' + i % 26);
+            int echo = client.POST("/echo", upload);
+            int headers = client.GET("/headers", "x-big: " + std::string(20000, 'B') + "\r\n");
+            CHECK(client.active_streams() == H2Peer::batch_size + 2);
+
+            for (size_t i = 0; i < batch.size(); ++i) {
+                std::string path = "/batch/" + std::to_string(i);
+                CHECK(client.receiveResponse(batch[i]) == 3000);
+                const Http2Response* r = client.get_stream_response(batch[i]);
+                CHECK(r && r->ok() && r->status == 200);
+                CHECK(r && r->body.compare(0, path.size(), path) == 0);
+            }
+            CHECK(client.receiveResponse(echo) == static_cast<int>(upload.size()));
+            const Http2Response* r = client.get_stream_response(echo);
+            CHECK(r && r->body == upload);
+            CHECK(client.receiveResponse(headers) > 0);
+            r = client.get_stream_response(headers);
+            CHECK(r && r->body == "20000");
+            bool large = false;
+            for (const auto& h : r ? r->headers : std::vector<hpack::Header>())
+                large |= h.name == "x-large" && h.value.size() == 20000;
+            CHECK(large);
+            CHECK(client.active_streams() == 0);
+        }
+
+        // GOAWAY: streams after last_stream_id fail as refused, the named
+        // one still completes and no new stream may start.
+        {
+            Http2v4 client;
+            client.set_port(port);
+            client.setTimeout(5000);
+            CHECK(client.initHttp("127.0.0.1") == 0);
+            CHECK(client.connectToServer() == 0);
+            int last = client.GET("/goaway");
+            int refused1 = client.GET("/never");
+            int refused2 = client.GET("/never");
+            CHECK(last > 0 && refused1 > last && refused2 > refused1);
+            CHECK(client.receiveResponse(last) == 3);
+            CHECK(std::string(client.getResponse()) == "bye");
+            CHECK(client.receiveResponse(refused1) == -1);
+            CHECK(client.receiveResponse(refused2) == -1);
+            const Http2Response* r = client.get_stream_response(refused1);
+            CHECK(r && r->complete && r->error_code == 0x7);
+            CHECK(client.GET("/after") == -1);
+        }
+        peer.stop();
+
+        CHECK(peer.connections == 2);
+        CHECK(peer.max_open_batch == H2Peer::batch_size);
+        CHECK(peer.continuations_received > 0);
+        CHECK(peer.window_updates_sent > 0);
+        CHECK(peer.flow_control_errors == 0);
+        CHECK(peer.protocol_errors == 0);
+        printf("  %zu concurrent streams on one connection, 200000-byte upload with %d WINDOW_UPDATEs,\n"
+               "  %d CONTINUATION frames received, GOAWAY refused the later streams\n",
+               peer.max_open_batch, peer.window_updates_sent, peer.continuations_received);
+    }
+}
+
+int main() {
+    test_dualstack();
+    test_http2();
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("all tests passed\n");
+    return 0;
+}
@@ -0,0 +1,288 @@
+#if !defined(FMX_TRACE_HPP)
+#define FMX_TRACE_HPP
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace fmx {
+    enum class TraceProtocol : uint8_t { Tcp, Udp, Sctp, Http };
+    enum class TraceDirection : uint8_t { Send, Recv };
+
+    // Trace file layout: this header, then records back to back, each a
+    // TraceRecordHeader followed by its payload padded to 8 bytes. Fields
+    // are in host byte order; the header is kept current after every record
+    // so a trace survives the recording process dying.
+    struct TraceFileHeader {
+        char magic[8];                  // "FMXTRACE"
+        uint32_t version;
+        uint32_t max_payload;           // payload bytes kept per record
+        uint64_t data_size;             // bytes of records after this header
+        uint64_t record_count;
+        uint64_t start_realtime_ns;     // wall clock when recording began
+    };
+
+    struct TraceRecordHeader {
+        uint64_t time_ns;               // since recording began (monotonic)
+        uint32_t connection;
+        uint32_t length;                // bytes actually sent or received
+        uint32_t captured;              // payload bytes stored, <= length
+        uint8_t direction;
+        uint8_t protocol;
+        uint16_t reserved;
+    };
+
+    struct TraceRecord {
+        uint64_t time_ns;
+        uint32_t connection;
+        uint32_t length;
+        TraceDirection direction;
+        TraceProtocol protocol;
+        std::string_view payload;       // may be shorter than length
+    };
+
+    namespace detail {
+        inline constexpr char trace_magic[8] = { 'F', 'M', 'X', 'T', 'R', 'A', 'C', 'E' };
+        inline constexpr uint32_t trace_version = 1;
+        inline size_t trace_padded(size_t n) { return (n + 7) & ~size_t(7); }
+    }
+
+    // Appends records to a memory-mapped trace file, growing it as needed.
+    // Safe to share between threads and connections.
+    class TraceWriter {
+    private:
+        int fd = -1;
+        char* base = nullptr;
+        size_t mapped = 0;
+        size_t used = 0;
+        uint32_t max_payload = UINT32_MAX;
+        std::chrono::steady_clock::time_point start;
+        std::atomic<uint32_t> next_connection{1};
+        std::mutex lock;
+
+        TraceFileHeader* header() { return reinterpret_cast<TraceFileHeader*>(base); }
+        int grow(size_t needed) {
+            size_t size = mapped;
+            while (size < needed) size *= 2;
+            if (ftruncate(fd, size) < 0) return -1;
+            void* p = mremap(base, mapped, size, MREMAP_MAYMOVE);
+            if (p == MAP_FAILED) return -1;
+            base = static_cast<char*>(p);
+            mapped = size;
+            return 0;
+        }
+    public:
+        TraceWriter() = default;
+        ~TraceWriter() { close(); }
+        TraceWriter(const TraceWriter&) = delete;
+        TraceWriter& operator=(const TraceWriter&) = delete;
+
+        // payload_limit caps the bytes kept per record; 0 records sizes and
+        // timings only.
+        int open(const char* path, uint32_t payload_limit = UINT32_MAX, size_t initial_size = 1 << 20) {
+            close();
+            fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd < 0) return -1;
+            mapped = std::max(initial_size, sizeof(TraceFileHeader));
+            if (ftruncate(fd, mapped) < 0) {
+                close();
+                return -1;
+            }
+            void* p = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (p == MAP_FAILED) {
+                ::close(fd);
+                fd = -1;
+                return -1;
+            }
+            base = static_cast<char*>(p);
+            max_payload = payload_limit;
+            start = std::chrono::steady_clock::now();
+            TraceFileHeader* h = header();
+            memcpy(h->magic, detail::trace_magic, sizeof(h->magic));
+            h->version = detail::trace_version;
+            h->max_payload = max_payload;
+            h->data_size = 0;
+            h->record_count = 0;
+            h->start_realtime_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            used = sizeof(TraceFileHeader);
+            return 0;
+        }
+        bool is_open() const { return base != nullptr; }
+        uint32_t new_connection() { return next_connection.fetch_add(1); }
+        uint64_t now_ns() const {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count();
+        }
+
+        int record(uint32_t connection, TraceProtocol protocol, TraceDirection direction,
+                   const char* data, size_t length, uint64_t time_ns) {
+            uint32_t captured = static_cast<uint32_t>(std::min<size_t>(length, max_payload));
+            size_t size = sizeof(TraceRecordHeader) + detail::trace_padded(captured);
+            std::lock_guard<std::mutex> guard(lock);
+            if (!base) return -1;
+            if (used + size > mapped && grow(used + size) < 0) return -1;
+            TraceRecordHeader* r = reinterpret_cast<TraceRecordHeader*>(base + used);
+            r->time_ns = time_ns;
+            r->connection = connection;
+            r->length = static_cast<uint32_t>(length);
+            r->captured = captured;
+            r->direction = static_cast<uint8_t>(direction);
+            r->protocol = static_cast<uint8_t>(protocol);
+            r->reserved = 0;
+            memcpy(r + 1, data, captured);
+            used += size;
+            header()->data_size = used - sizeof(TraceFileHeader);
+            ++header()->record_count;
+            return 0;
+        }
+
+        // Trims the file to the recorded size.
+        void close() {
+            std::lock_guard<std::mutex> guard(lock);
+            if (base) {
+                munmap(base, mapped);
+                base = nullptr;
+                int ret = ftruncate(fd, used);
+                (void)ret;
+            }
+            if (fd >= 0) {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+    };
+
+    // Read-only view of a trace file.
+    class TraceReader {
+    private:
+        const char* base = nullptr;
+        size_t size = 0;
+
+        const TraceFileHeader* header() const { return reinterpret_cast<const TraceFileHeader*>(base); }
+    public:
+        TraceReader() = default;
+        ~TraceReader() { if (base) munmap(const_cast<char*>(base), size); }
+        TraceReader(const TraceReader&) = delete;
+        TraceReader& operator=(const TraceReader&) = delete;
+
+        int open(const char* path) {
+            int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+            if (fd < 0) return -1;
+            struct stat st;
+            if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < sizeof(TraceFileHeader)) {
+                ::close(fd);
+                return -1;
+            }
+            void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (p == MAP_FAILED) return -1;
+            base = static_cast<const char*>(p);
+            size = st.st_size;
+            const TraceFileHeader* h = header();
+            if (memcmp(h->magic, detail::trace_magic, sizeof(h->magic)) != 0 ||
+                h->version != detail::trace_version || sizeof(TraceFileHeader) + h->data_size > size) {
+                munmap(p, size);
+                base = nullptr;
+                return -1;
+            }
+            return 0;
+        }
+        uint64_t record_count() const { return base ? header()->record_count : 0; }
+        uint64_t start_realtime_ns() const { return base ? header()->start_realtime_ns : 0; }
+
+        // Calls fn(const TraceRecord&) for every record in recording order.
+        template <typename Fn>
+        void for_each(Fn&& fn) const {
+            if (!base) return;
+            const char* p = base + sizeof(TraceFileHeader);
+            const char* end = p + header()->data_size;
+            while (p + sizeof(TraceRecordHeader) <= end) {
+                const TraceRecordHeader* r = reinterpret_cast<const TraceRecordHeader*>(p);
+                size_t next = sizeof(TraceRecordHeader) + detail::trace_padded(r->captured);
+                if (next > static_cast<size_t>(end - p)) break;
+                TraceRecord record{ r->time_ns, r->connection, r->length,
+                                    static_cast<TraceDirection>(r->direction),
+                                    static_cast<TraceProtocol>(r->protocol),
+                                    std::string_view(reinterpret_cast<const char*>(r + 1), r->captured) };
+                fn(record);
+                p += next;
+            }
+        }
+    };
+
+    namespace detail {
+        template <typename T, typename = void>
+        struct trace_protocol_of {
+            static constexpr TraceProtocol value = TraceProtocol::Tcp;
+        };
+        template <typename T>
+        struct trace_protocol_of<T, std::void_t<typename T::protocol_type>> {
+            static constexpr TraceProtocol value =
+                T::protocol_type::protocol == IPPROTO_SCTP ? TraceProtocol::Sctp :
+                T::protocol_type::type == SOCK_DGRAM ? TraceProtocol::Udp : TraceProtocol::Tcp;
+        };
+    }
+
+    // Transport wrapper logging send_data/recv_data/recv_some to a trace.
+    // The wrapped calls are hidden statically, not overridden, so only code
+    // that holds the Recorded type sees them: HttpImpl<Recorded<TcpIPv4>> and
+    // FrameCodec(recorded) record, anything going through TcpBase& does not.
+    // TcpPool<Recorded<...>> creates its connections itself and never traces
+    // them; call set_trace on a lease whose get_trace_connection() is 0.
+    template <typename Transport>
+    class Recorded : public Transport {
+    private:
+        TraceWriter* trace = nullptr;
+        uint32_t connection = 0;
+        TraceProtocol protocol = detail::trace_protocol_of<Transport>::value;
+    public:
+        Recorded() = default;
+
+        // Starts a new trace connection. Pass TraceProtocol::Http for the
+        // transport of an HttpImpl so the replayer reissues the requests.
+        void set_trace(TraceWriter* writer, TraceProtocol p = detail::trace_protocol_of<Transport>::value) {
+            trace = writer;
+            protocol = p;
+            connection = writer ? writer->new_connection() : 0;
+        }
+        uint32_t get_trace_connection() const { return connection; }
+
+        // Send records carry the time the call started.
+        template <typename... Args>
+        int send_data(const std::string& data, Args&&... args) {
+            uint64_t t = trace ? trace->now_ns() : 0;
+            int ret = Transport::send_data(data, std::forward<Args>(args)...);
+            if (trace && ret > 0) trace->record(connection, protocol, TraceDirection::Send, data.data(), ret, t);
+            return ret;
+        }
+        template <typename... Args>
+        int recv_data(std::string& result, Args&&... args) {
+            int ret = Transport::recv_data(result, std::forward<Args>(args)...);
+            if (trace && ret > 0)
+                trace->record(connection, protocol, TraceDirection::Recv, result.data(), ret, trace->now_ns());
+            return ret;
+        }
+        int recv_some(char* buffer, size_t length) {
+            int ret = Transport::recv_some(buffer, length);
+            if (trace && ret > 0)
+                trace->record(connection, protocol, TraceDirection::Recv, buffer, ret, trace->now_ns());
+            return ret;
+        }
+    };
+}
+
+#endif // FMX_TRACE_HPP
@@ -7,18 +7,29 @@
 #include <fcntl.h>
 #include <netdb.h>
 #include <sys/select.h>
+#include "sockopt.hpp"
+#include "socket.hpp"
 
 namespace fmx {
     class UdpBase {
     protected:
         int socket_fd = -1;
         unsigned long long time_out = 0;
+        SocketProfile profile;
+        void on_open() { apply_socket_profile(socket_fd, profile, false); }
     public:
         UdpBase() = default;
         virtual ~UdpBase() { if (socket_fd >= 0) close_connection(); }
         
+        int get_fd() const { return socket_fd; }
         void set_timeout(unsigned long long ms) { time_out = ms; }
         
+        // Stored and applied at initUdp; only buffer sizes and busy-poll apply.
+        int set_profile(const SocketProfile& p) {
+            profile = p;
+            return socket_fd >= 0 ? apply_socket_profile(socket_fd, profile, false) : 0;
+        }
+        
         int send_data(const std::string& data, const struct sockaddr* dest_addr, socklen_t addr_len) {
             if (time_out > 0) {
                 fd_set write_set;
@@ -62,127 +73,42 @@ namespace fmx {
         }
     };
 
-    class UdpIPv4 : public UdpBase {
-    private:
-        struct sockaddr_in server_addr{};
-    public:
-        UdpIPv4() = default;
-        ~UdpIPv4() override = default;
-        
-        int initUdp() {
-            socket_fd = socket(AF_INET, SOCK_DGRAM, 0);
-            return socket_fd < 0 ? -1 : 0;
-        }
-        
-        int set_address(const char* ip, int port) {
-            server_addr.sin_family = AF_INET;
-            server_addr.sin_port = htons(port);
-            if (inet_pton(AF_INET, ip, &server_addr.sin_addr) <= 0) {
-                close(socket_fd);
-                return -1;
-            }
-            return 0;
-        }
-        
-        int bind_port(unsigned short port) {
-            struct sockaddr_in addr{};
-            addr.sin_family = AF_INET;
-            addr.sin_addr.s_addr = INADDR_ANY;
-            addr.sin_port = htons(port);
-            return bind(socket_fd, (struct sockaddr*)&addr, sizeof(addr));
-        }
-        
-        const struct sockaddr* get_server_addr() const { 
-            return reinterpret_cast<const struct sockaddr*>(&server_addr); 
-        }
-        
-        socklen_t get_addr_len() const { 
-            return sizeof(server_addr); 
-        }
+    struct Datagram {
+        using base_type = UdpBase;
+        static constexpr int type = SOCK_DGRAM;
+        static constexpr int protocol = 0;
     };
 
-    class UdpIPv6 : public UdpBase {
-    private:
-        struct sockaddr_in6 server_addr{};
+    template <typename Family>
+    class UdpImpl : public Socket<Family, Datagram> {
     public:
-        UdpIPv6() = default;
-        ~UdpIPv6() override = default;
-        
-        int initUdp() {
-            socket_fd = socket(AF_INET6, SOCK_DGRAM, 0);
-            return socket_fd < 0 ? -1 : 0;
-        }
-        
-        int set_address(const char* ip, int port) {
-            server_addr.sin6_family = AF_INET6;
-            server_addr.sin6_port = htons(port);
-            if (inet_pton(AF_INET6, ip, &server_addr.sin6_addr) <= 0) {
-                close(socket_fd);
-                return -1;
-            }
-            return 0;
-        }
-        
-        int bind_port(unsigned short port) {
-            struct sockaddr_in6 addr{};
-            addr.sin6_family = AF_INET6;
-            addr.sin6_addr = in6addr_any;
-            addr.sin6_port = htons(port);
-            return bind(socket_fd, (struct sockaddr*)&addr, sizeof(addr));
-        }
-        
-        const struct sockaddr* get_server_addr() const { 
-            return reinterpret_cast<const struct sockaddr*>(&server_addr); 
-        }
+        UdpImpl() = default;
+        ~UdpImpl() override = default;
         
-        socklen_t get_addr_len() const { 
-            return sizeof(server_addr); 
-        }
+        int initUdp() { return this->open_socket(); }
     };
 
-    class UdpServerIPv4 {
-    private:
-        UdpIPv4 socket;
-    public:
-        UdpServerIPv4() = default;
-        ~UdpServerIPv4() = default;
-        
-        int bind_port(unsigned short port) {
-            if (socket.initUdp() < 0) return -1;
-            return socket.bind_port(port);
-        }
-        
-        int recv_data(std::string& result, struct sockaddr_in* client_addr) {
-            socklen_t addr_len = sizeof(*client_addr);
-            return socket.recv_data(
-                result, 
-                reinterpret_cast<struct sockaddr*>(client_addr), 
-                &addr_len
-            );
-        }
-        
-        int send_data(const std::string& data, const struct sockaddr_in* client_addr) {
-            return socket.send_data(
-                data, 
-                reinterpret_cast<const struct sockaddr*>(client_addr), 
-                sizeof(*client_addr)
-            );
-        }
-    };
+    using UdpIPv4 = UdpImpl<IPv4>;
+    using UdpIPv6 = UdpImpl<IPv6>;
 
-    class UdpServerIPv6 {
+    template <typename Family>
+    class UdpServer {
     private:
-        UdpIPv6 socket;
+        UdpImpl<Family> socket;
     public:
-        UdpServerIPv6() = default;
-        ~UdpServerIPv6() = default;
+        using sockaddr_type = typename Family::sockaddr_type;
+
+        UdpServer() = default;
+        ~UdpServer() = default;
+        
+        int set_profile(const SocketProfile& p) { return socket.set_profile(p); }
         
         int bind_port(unsigned short port) {
             if (socket.initUdp() < 0) return -1;
             return socket.bind_port(port);
         }
         
-        int recv_data(std::string& result, struct sockaddr_in6* client_addr) {
+        int recv_data(std::string& result, sockaddr_type* client_addr) {
             socklen_t addr_len = sizeof(*client_addr);
             return socket.recv_data(
                 result, 
@@ -191,7 +117,7 @@ namespace fmx {
             );
         }
         
-        int send_data(const std::string& data, const struct sockaddr_in6* client_addr) {
+        int send_data(const std::string& data, const sockaddr_type* client_addr) {
             return socket.send_data(
                 data, 
                 reinterpret_cast<const struct sockaddr*>(client_addr), 
@@ -199,6 +125,9 @@ namespace fmx {
             );
         }
     };
+
+    using UdpServerIPv4 = UdpServer<IPv4>;
+    using UdpServerIPv6 = UdpServer<IPv6>;
 }
 
 #endif // FMX_UDP_HPP
\ No newline at end of file
@@ -0,0 +1,174 @@
+#if !defined(FMX_UNIX_HPP)
+#define FMX_UNIX_HPP
+
+#include "tcp.hpp"
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+namespace fmx {
+    // AF_UNIX family policy. Addresses are filesystem paths; the port argument
+    // is accepted for interface compatibility and ignored.
+    struct Local {
+        using sockaddr_type = struct sockaddr_un;
+        static constexpr int domain = AF_UNIX;
+        static int set_address(sockaddr_type& addr, const char* path, int /*port*/) {
+            if (!path || strlen(path) >= sizeof(addr.sun_path)) return -1;
+            memset(&addr, 0, sizeof(addr));
+            addr.sun_family = AF_UNIX;
+            strcpy(addr.sun_path, path);
+            return 0;
+        }
+    };
+
+    struct SeqPacket {
+        using base_type = TcpBase;
+        static constexpr int type = SOCK_SEQPACKET;
+        static constexpr int protocol = 0;
+    };
+
+    // Same send_data/recv_data/timeout surface as TcpIPv4, so it drops into
+    // HttpImpl, TcpPool and FrameCodec unchanged (initTcp/set_address(path, 0)).
+    using UnixStream = TcpImpl<Local, Stream>;
+
+    // Message-preserving variant: every send_data is one packet. Reads never
+    // truncate a packet: recv_some and recv_data fail with EMSGSIZE (leaving
+    // the packet queued) when the next one does not fit the space given, so
+    // use recv_message for packets of unknown size.
+    class UnixSeqpacket : public TcpImpl<Local, SeqPacket> {
+    private:
+        int wait_readable() {
+            if (time_out == 0) return 0;
+            fd_set read_set;
+            FD_ZERO(&read_set);
+            FD_SET(socket_fd, &read_set);
+            struct timeval tv;
+            tv.tv_sec = time_out / 1000;
+            tv.tv_usec = (time_out % 1000) * 1000;
+            return select(socket_fd + 1, &read_set, nullptr, nullptr, &tv) <= 0 ? -1 : 0;
+        }
+        // MSG_TRUNC makes the peek report the full packet length.
+        ssize_t next_packet_size() { return recv(socket_fd, nullptr, 0, MSG_PEEK | MSG_TRUNC); }
+    public:
+        UnixSeqpacket() = default;
+        ~UnixSeqpacket() override = default;
+        // Receives exactly one packet, whatever its size. Returns its size or -1.
+        int recv_message(std::string& result) {
+            if (wait_readable() < 0) return -1;
+            ssize_t size = next_packet_size();
+            if (size < 0) return -1;
+            result.clear();
+            if (size == 0) {
+                // Consumes an empty packet; also reports end of stream.
+                return recv(socket_fd, nullptr, 0, 0) < 0 ? -1 : 0;
+            }
+            result.resize(size);
+            ssize_t received_bytes = recv(socket_fd, &result[0], size, 0);
+            if (received_bytes < 0) return -1;
+            result.resize(received_bytes);
+            return static_cast<int>(received_bytes);
+        }
+        // Receives one packet of at most length bytes.
+        int recv_some(char* buffer, size_t length) {
+            if (wait_readable() < 0) return -1;
+            ssize_t size = next_packet_size();
+            if (size < 0) return -1;
+            if (static_cast<size_t>(size) > length) {
+                errno = EMSGSIZE;
+                return -1;
+            }
+            ssize_t received_bytes = recv(socket_fd, buffer, size, 0);
+            return received_bytes < 0 ? -1 : static_cast<int>(received_bytes);
+        }
+        // Receives whole packets until length bytes arrived. Stops early,
+        // returning the bytes so far, at end of stream, on timeout, or before
+        // a packet that would overshoot length (-1 if that is the first one).
+        int recv_data(std::string& result, size_t length) {
+            result.clear();
+            while (result.size() < length) {
+                if (wait_readable() < 0) break;
+                ssize_t size = next_packet_size();
+                if (size <= 0) break;
+                if (static_cast<size_t>(size) > length - result.size()) {
+                    if (result.empty()) {
+                        errno = EMSGSIZE;
+                        return -1;
+                    }
+                    break;
+                }
+                size_t used = result.size();
+                result.resize(used + size);
+                ssize_t received_bytes = recv(socket_fd, &result[used], size, 0);
+                if (received_bytes < 0) {
+                    result.resize(used);
+                    break;
+                }
+            }
+            return static_cast<int>(result.size());
+        }
+    };
+
+    template <typename Client>
+    class UnixServer {
+    private:
+        int listen_fd = -1;
+        std::string path;
+
+        // A socket file nobody listens on any more refuses connections.
+        static bool is_stale(const struct sockaddr_un& addr) {
+            int fd = socket(AF_UNIX, Client::protocol_type::type, 0);
+            if (fd < 0) return false;
+            bool stale = connect(fd, (const struct sockaddr*)&addr, sizeof(addr)) < 0 && errno == ECONNREFUSED;
+            close(fd);
+            return stale;
+        }
+    public:
+        UnixServer() = default;
+        ~UnixServer() {
+            if (listen_fd >= 0) close(listen_fd);
+            if (!path.empty()) unlink(path.c_str());
+        }
+        // Replaces a stale socket file left at path; it is removed again on
+        // destruction. Fails if path is not a socket or a server still
+        // accepts connections on it.
+        int bind_path(const char* p) {
+            struct sockaddr_un addr{};
+            if (Local::set_address(addr, p, 0) < 0) return -1;
+            struct stat st;
+            if (lstat(p, &st) == 0) {
+                if (!S_ISSOCK(st.st_mode) || !is_stale(addr)) return -1;
+                unlink(p);
+            }
+            if (listen_fd >= 0) close(listen_fd);
+            if (!path.empty()) unlink(path.c_str());
+            path.clear();
+            listen_fd = socket(AF_UNIX, Client::protocol_type::type, 0);
+            if (listen_fd < 0) return -1;
+            if (bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+                close(listen_fd);
+                listen_fd = -1;
+                return -1;
+            }
+            path = p;
+            return 0;
+        }
+        int start_listen(int backlog = 5) {
+            if (listen(listen_fd, backlog) < 0) return -1;
+            return 0;
+        }
+        Client accept_client() {
+            int client_fd = accept(listen_fd, nullptr, nullptr);
+            Client cli;
+            cli.set_fd(client_fd);
+            return cli;
+        }
+        int get_fd() const { return listen_fd; }
+    };
+
+    using UnixStreamServer = UnixServer<UnixStream>;
+    using UnixSeqpacketServer = UnixServer<UnixSeqpacket>;
+}
+
+#endif // FMX_UNIX_HPP